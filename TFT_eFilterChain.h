@@ -0,0 +1,183 @@
+#ifndef TFT_E_FILTER_CHAIN_H
+#define TFT_E_FILTER_CHAIN_H
+
+//
+//  TFT_eFilterChain.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+
+/** 
+  * Hold the output until the input moves more than D away, the output then follows with distance D.
+  * Removes the last jitter of a resting pen without a jump when it starts moving.
+  * @brief  deadband filter
+  * @param  D half width of the band
+  * @param  T used data type
+  */
+template <uint16_t D = 2, class T = uint16_t>
+class Deadband
+{
+public:
+  Deadband(uint8_t filter = 0, bool warm_start = false)
+  : out_(0)
+  , filled_(0)
+  {
+    (void)filter;
+    (void)warm_start;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value, replaced by the held value
+  * @return always true
+  */
+  bool filter(T& val)
+  {
+    if (filled_ == 0) {
+      out_ = val;
+      filled_ = 1;
+    }
+    else if (val > out_ + D) out_ = val - D;
+    else if (val + D < out_) out_ = val + D;
+    val = out_;
+    return true;
+  }
+
+  T next(T val)
+  {
+    filter(val);
+    return val;
+  }
+
+  inline void reset()
+  {
+    filled_ = 0;
+  }
+
+  inline uint16_t size() const
+  {
+    return 1;
+  }
+
+  inline uint16_t filled() const
+  {
+    return filled_;
+  }
+
+  inline void setWarmStart(bool)
+  {
+  }
+
+  inline bool getWarmStart() const
+  {
+    return true;
+  }
+
+private:
+  T out_;
+  uint8_t filled_;
+};
+
+/** 
+  * Filter stages run one after the other on the same channel, e.g.
+@code
+#define TOUCH_X_FILTER FilterChain<MedianFilter<5>, FirFilter<12>, Deadband<2> >
+@endcode
+  * The stages are members, no heap is used and the compiler can inline the whole chain.
+  * A stage needs the FirFilter interface: constructor (uint8_t filter, bool warm_start), bool filter(uint16_t&), reset(), size(), filled(), setWarmStart() and getWarmStart().
+  * filter() is false as long as one stage is not filled, the following stages do not get the value then.
+  * @brief  filter pipeline
+  * @param  S filter stages
+  */
+template <class... S>
+class FilterChain;
+
+/// end of the chain
+template <>
+class FilterChain<>
+{
+public:
+  FilterChain(uint8_t = 0, bool = false) {}
+  inline bool filter(uint16_t&) { return true; }
+  inline uint16_t next(uint16_t val) { return val; }
+  inline void reset() {}
+  inline uint16_t size() const { return 0; }
+  inline uint16_t filled() const { return 0; }
+  inline void setWarmStart(bool) {}
+  inline bool getWarmStart() const { return true; }
+};
+
+template <class First, class... Rest>
+class FilterChain<First, Rest...>
+{
+public:
+  FilterChain(uint8_t filter = 1, bool warm_start = false)
+  : first_(filter, warm_start)
+  , rest_(filter, warm_start)
+  {
+  }
+
+/**
+  * @brief  filter next value through all stages
+  * @param  val new value, replaced by the filtered value
+  * @return false while a stage is not filled, val is undefined then
+  */
+  inline bool filter(uint16_t& val)
+  {
+    return first_.filter(val) && rest_.filter(val);
+  }
+
+/**
+  * @brief  filter next value through all stages
+  * @param  val new value
+  * @return filtered value, 0 while a stage is not filled
+  */
+  inline uint16_t next(uint16_t val)
+  {
+    return filter(val) ? val : 0;
+  }
+
+  inline void reset()
+  {
+    first_.reset();
+    rest_.reset();
+  }
+
+  inline uint16_t size() const ///< values of all stages
+  {
+    return first_.size() + rest_.size();
+  }
+
+  inline uint16_t filled() const ///< filled values of all stages
+  {
+    return first_.filled() + rest_.filled();
+  }
+
+  inline void setWarmStart(bool warm_start)
+  {
+    first_.setWarmStart(warm_start);
+    rest_.setWarmStart(warm_start);
+  }
+
+  inline bool getWarmStart() const ///< true when every stage report the first value
+  {
+    return first_.getWarmStart() && rest_.getWarmStart();
+  }
+
+  inline First& stage() { return first_; } ///< first stage
+  inline FilterChain<Rest...>& rest() { return rest_; } ///< following stages
+
+private:
+  First first_;
+  FilterChain<Rest...> rest_;
+};
+
+#endif // TFT_E_FILTER_CHAIN_H
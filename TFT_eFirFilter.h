@@ -13,6 +13,128 @@
 //  See TFT_eTouch/docs/html/index.html for documentation.
 //
 
+#ifdef TOUCH_USE_LOG
+#include <TFT_eTouchLog.h>
+#endif
+
+// window coefficients are calculated by the compiler and stored in flash, no libm needed
+// w[n] = 0.54 - 0.46cos(2pin/N) Hamming window
+// w[n] = 0.5[1-cos(2pin/N)] Hanning window
+// w[n] = 0.42 - 0.5cos(2pin/N) + 0.08cos(4pin/N) Blackmann window
+
+constexpr double fir_pi = 3.14159265358979323846;
+
+/// taylor series of cos, x2 = xx
+constexpr double fir_cos_series(double x2, double term, uint8_t n)
+{
+  return n > 40 ? 0 : term + fir_cos_series(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+}
+
+/// cos for 0 <= x <= 4pi
+constexpr double fir_cos(double x)
+{
+  return x > 3 * fir_pi ? fir_cos(x - 2 * fir_pi)
+    : x > fir_pi ? fir_cos_series((x - 2 * fir_pi) * (x - 2 * fir_pi), 1, 0)
+    : fir_cos_series(x * x, 1, 0);
+}
+
+/// window value i of N, w[N/2] is 1
+constexpr double fir_w(uint8_t window, uint16_t i, uint16_t N)
+{
+  return window == 2 ? 0.5 * (1 - fir_cos(2 * fir_pi * i / N))
+    : window == 3 ? 0.42 - 0.5 * fir_cos(2 * fir_pi * i / N) + 0.08 * fir_cos(4 * fir_pi * i / N)
+    : 0.54 - 0.46 * fir_cos(2 * fir_pi * i / N); // Hamming
+}
+
+/// sum of window values i .. N/2-1, each used twice
+constexpr double fir_w_pairs(uint8_t window, uint16_t i, uint16_t N)
+{
+  return i >= N/2 ? 0 : 2 * fir_w(window, i, N) + fir_w_pairs(window, i + 1, N);
+}
+
+/// sum of all N window values
+constexpr double fir_w_sum(uint8_t window, uint16_t N)
+{
+  return fir_w(window, 0, N) + fir_w_pairs(window, 1, N) + fir_w(window, N/2, N);
+}
+
+/// largest shift where q[N/2] fits in a byte (N/2 reserved for rounding)
+constexpr uint8_t fir_shift(uint8_t window, uint16_t N, uint8_t shift = 0)
+{
+  return (1UL << (shift + 1)) / fir_w_sum(window, N) > 255 - N/2 ? shift : fir_shift(window, N, shift + 1);
+}
+
+/// rounded coefficient i < N/2
+constexpr uint8_t fir_q_round(uint8_t window, uint16_t i, uint16_t N)
+{
+  return (uint8_t)(fir_w(window, i, N) * (1UL << fir_shift(window, N)) / fir_w_sum(window, N) + 0.5);
+}
+
+/// sum of rounded coefficients i .. N/2-1, each used twice
+constexpr uint32_t fir_q_pairs(uint8_t window, uint16_t i, uint16_t N)
+{
+  return i >= N/2 ? 0 : 2 * fir_q_round(window, i, N) + fir_q_pairs(window, i + 1, N);
+}
+
+/// coefficient i of N, q[N/2] takes the rounding error so the sum of all N is exactly 1 << fir_shift()
+constexpr uint8_t fir_q(uint8_t window, uint16_t i, uint16_t N)
+{
+  return i < N/2 ? fir_q_round(window, i, N)
+    : (uint8_t)((1UL << fir_shift(window, N)) - fir_q_round(window, 0, N) - fir_q_pairs(window, 1, N));
+}
+
+template <uint16_t... I> struct FirIndex {};
+template <uint16_t C, uint16_t... I> struct FirMakeIndex : FirMakeIndex<C - 1, C - 1, I...> {};
+template <uint16_t... I> struct FirMakeIndex<0, I...> { typedef FirIndex<I...> type; };
+
+/**
+  * Coefficient table in flash, q[i] is used for the value i and N-i back.
+  * The N weights sum up to 1 << shift, the weighted sum is normalized by a shift.
+  * @brief  fir window
+  * @param  N number of coefficients, must be even
+  * @param  W window type, see TOUCH_FILTER_TYPE
+  */
+template <uint16_t N, uint8_t W, class I = typename FirMakeIndex<N/2+1>::type>
+struct FirWindow;
+
+template <uint16_t N, uint8_t W, uint16_t... I>
+struct FirWindow<N, W, FirIndex<I...> >
+{
+  static_assert(N >= 4 && (N & 1) == 0, "N must be even");
+  static_assert((1UL << fir_shift(W, N)) - fir_q_round(W, 0, N) - fir_q_pairs(W, 1, N) <= 255, "center coefficient overflow");
+  static constexpr uint8_t shift = fir_shift(W, N);
+  static const uint8_t q[N/2+1];
+};
+
+template <uint16_t N, uint8_t W, uint16_t... I>
+constexpr uint8_t FirWindow<N, W, FirIndex<I...> >::shift;
+
+template <uint16_t N, uint8_t W, uint16_t... I>
+const uint8_t FirWindow<N, W, FirIndex<I...> >::q[N/2+1] PROGMEM = { fir_q(W, I, N)... };
+
+/**
+  * @brief  select window table
+  * @param  N number of coefficients, must be even
+  * @param  filter window type, see TOUCH_FILTER_TYPE (Hamming when unknown)
+  * @param  shift set to normalization shift
+  * @return coefficients in flash
+  */
+template <uint16_t N>
+const uint8_t* fir_window(uint8_t filter, uint8_t& shift)
+{
+  switch (filter) {
+  case 2:
+    shift = FirWindow<N, 2>::shift;
+    return FirWindow<N, 2>::q;
+  case 3:
+    shift = FirWindow<N, 3>::shift;
+    return FirWindow<N, 3>::q;
+  default:
+    shift = FirWindow<N, 1>::shift;
+    return FirWindow<N, 1>::q;
+  }
+}
+
 /** 
   * @brief  fir filter
   * @param  N number of coefficients, must be even
@@ -22,8 +144,9 @@ template <uint16_t N = 12, class T = uint16_t>
 class FirFilter
 {
 public:
-  FirFilter(uint8_t filter = 1)
-  : divisor_(0)
+  FirFilter(uint8_t filter = 1, bool warm_start = false)
+  : shift_(0)
+  , warm_start_(warm_start)
   , filled_(0)
   {
     calc_q(filter);
@@ -31,85 +154,65 @@ public:
 
   void calc_q(uint8_t filter)
   {
-    // calculate q for Hamming window
-    // w[n] = 0.54 - 0.46cos(2pin/N)
-    // w[n] = 0.5[1-cos(2pin/N)] Hanning window
-    // w[n] = 0.42 - 0.5cos(2pin/N) + 0.08cos(4pin/N) Blackmann window
-    for (uint16_t i = 0; i < N/2+1; i++) {
-      uint8_t qi;
-      switch (filter) {
-      case 1: // Hamming window
-        qi = (uint8_t)((0.54 - 0.46 * cos(2 * PI * i / N)) * 255);
-        break;
-      case 2: // Hanning window
-        qi = (uint8_t)((0.5 * (1 - cos(2 * PI * i / N))) * 255);
-        break;
-      case 3: // Blackmann window
-        qi = (uint8_t)((0.42 - 0.5 * cos(2 * PI * i / N) + 0.08 * cos(4 * PI * i / N)) * 255);
-        break;
-      default:
-        qi = 0;
-      }
-      divisor_ += 2*qi;
-      q_[i] = qi;
-#ifdef TOUCH_SERIAL_DEBUG
-      if (Serial) {
-        Serial.printf("q[%i]: %i\n", i, q_[i]);
-      }
-#endif
-    }
-    divisor_ -= 255; // q[N/2+1] only once
-    if (N <= 8)
-      divisor_ = divisor_ * 1000/1024; // some adjustment N=6
-    else if (N <= 14)
-      divisor_ = divisor_ * 1011/1024; // some adjustment N=12
-    else if (N <= 26)
-      divisor_ = divisor_ * 1017/1024; // some adjustment N=20
-    else
-      divisor_ = divisor_ * 1020/1024; // some adjustment N=40
-
-#ifdef TOUCH_SERIAL_DEBUG
-      if (Serial) {
-        Serial.printf("divisor: %i\n", divisor_);
-      }
-#endif
-
+    q_ = fir_window<N>(filter, shift_);
     reset();
   }
 
-  T next(T val)
+/**
+  * @brief  filter next value
+  * @param  val new value, replaced by the filtered value
+  * @return false while the filter is not filled, val is unchanged then
+  */
+  bool filter(T& val)
   {
-    T ret = 0;
+    if (filled_ == 0 && warm_start_) { // first value fill the filter, result is the value
+      for (uint16_t i = 0; i < 2*N; i++) buffer_[i] = val;
+      filled_ = N;
+    }
     buffer_[act_] = val;
+    buffer_[act_ + N] = val; // mirror, the last N values are in a row ending at buffer_[act_ + N]
     if (filled_ < N) {
       filled_++;
       if (filled_ < N) {
         act_++;
-        return ret;
+        return false;
       }
-#ifdef TOUCH_SERIAL_DEBUG
+#ifdef TOUCH_USE_LOG
+      else TOUCH_LOG(log_filter_ready, N, shift_);
+#elif defined (TOUCH_SERIAL_DEBUG)
       else {
         if (Serial) {
           Serial.print("q: ");
           for (uint16_t i = 0; i < N/2; i++) {
-            Serial.printf("%i, ", q_[i]);
+            Serial.printf("%i, ", pgm_read_byte(q_ + i));
           }
-          Serial.println(q_[N/2]);
+          Serial.println(pgm_read_byte(q_ + N/2));
         }
       }
 #endif
     }
-    uint32_t sum = 0;
-    for (uint16_t i = 0; i < N; i++) {
-      uint16_t pos_q = i < N/2+1 ? i : N - i;
-      uint16_t pos_b = (N + act_ - i) % N;
-      sum += buffer_[pos_b] * q_[pos_q];
+    // q is symmetric: value i back and value N-i back share q[i], add them before multiplying
+    const T* newer = buffer_ + act_ + N;
+    const T* older = newer - (N - 1);
+    uint32_t sum = (uint32_t)newer[0] * pgm_read_byte(q_) + (uint32_t)*(newer - N/2) * pgm_read_byte(q_ + N/2);
+    for (uint16_t i = 1; i < N/2; i++) {
+      sum += ((uint32_t)*--newer + *older++) * pgm_read_byte(q_ + i);
     }
-    ret = sum / divisor_;
+    val = (sum + (1UL << shift_ >> 1)) >> shift_;
     act_++;
     if (act_ >= N) act_ = 0;
 
-    return ret;
+    return true;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value
+  * @return filtered value, 0 while the filter is not filled
+  */
+  T next(T val)
+  {
+    return filter(val) ? val : 0;
   }
 
   inline void reset()
@@ -128,10 +231,188 @@ public:
     return filled_;
   }
 
+/**
+  * Without warm start next() gives no result until N values are filtered.
+  * With warm start the first value after reset() fill the whole filter, a result is available at once
+  * and converge to the filtered value within N values.
+  * @brief  set warm start
+  * @param  warm_start true: fill filter with first value
+  */
+  inline void setWarmStart(bool warm_start)
+  {
+    warm_start_ = warm_start;
+  }
+
+  inline bool getWarmStart() const
+  {
+    return warm_start_;
+  }
+
 private:
-  T buffer_[N];
-  uint8_t q_[N/2+1];
-  uint32_t divisor_;
+  T buffer_[2*N]; ///< every value twice, at act_ and act_ + N
+  const uint8_t* q_; ///< coefficients in flash, see FirWindow
+  uint8_t shift_; ///< normalization of the weighted sum
+  bool warm_start_; ///< first value fill the filter
+  uint16_t filled_;
+  uint16_t act_;
+};
+
+#if defined (__GNUC__) && !defined (__AVR__)
+// the lanes of FirFilterBank are processed with gcc vector extensions (SSE / NEON on host, scalar code on xtensa)
+#define TOUCH_FIR_VECTOR
+#endif
+
+#ifdef TOUCH_FIR_VECTOR
+/// all channels of one point in time for FirFilterBank
+template <uint8_t Lanes> struct FirLanes;
+template <> struct FirLanes<1> { typedef uint32_t type __attribute__((vector_size(4))); };
+template <> struct FirLanes<2> { typedef uint32_t type __attribute__((vector_size(8))); };
+template <> struct FirLanes<4> { typedef uint32_t type __attribute__((vector_size(16))); };
+#endif
+
+/**
+  * Filter up to four channels (e.g. x, y, z1, z2) with the same fir window in one pass.
+  * The values of one point in time are stored together, so every coefficient is loaded once for all lanes,
+  * and all lanes share one fill counter.
+  * @brief  fir filter for several channels
+  * @param  N number of coefficients, must be even
+  * @param  Lanes number of channels 1, 2 or 4
+  * @param  T used data type
+  */
+template <uint16_t N = 12, uint8_t Lanes = 4, class T = uint16_t>
+class FirFilterBank
+{
+  static_assert(Lanes == 1 || Lanes == 2 || Lanes == 4, "Lanes must be 1, 2 or 4");
+
+public:
+  FirFilterBank(uint8_t filter = 1, bool warm_start = false)
+  : shift_(0)
+  , warm_start_(warm_start)
+  , filled_(0)
+  {
+    calc_q(filter);
+  }
+
+  void calc_q(uint8_t filter)
+  {
+    q_ = fir_window<N>(filter, shift_);
+    reset();
+  }
+
+/**
+  * @brief  filter next values
+  * @param  val Lanes values, replaced by the filtered values
+  * @return false while the filter is not filled, val is unchanged then
+  */
+  bool next(T* val)
+  {
+#ifdef TOUCH_FIR_VECTOR
+    Lane in;
+    for (uint8_t l = 0; l < Lanes; l++) in[l] = val[l];
+    if (filled_ == 0 && warm_start_) { // first values fill the filter, see FirFilter
+      for (uint16_t i = 0; i < 2*N; i++) buffer_[i] = in;
+      filled_ = N;
+    }
+    buffer_[act_] = in;
+    buffer_[act_ + N] = in; // mirror, see FirFilter
+#else
+    if (filled_ == 0 && warm_start_) { // first values fill the filter, see FirFilter
+      for (uint16_t i = 0; i < 2*N; i++) {
+        for (uint8_t l = 0; l < Lanes; l++) buffer_[i][l] = val[l];
+      }
+      filled_ = N;
+    }
+    for (uint8_t l = 0; l < Lanes; l++) {
+      buffer_[act_][l] = val[l];
+      buffer_[act_ + N][l] = val[l]; // mirror, see FirFilter
+    }
+#endif
+    if (filled_ < N) {
+      filled_++;
+      if (filled_ < N) {
+        act_++;
+        return false;
+      }
+#ifdef TOUCH_USE_LOG
+      TOUCH_LOG(log_filter_ready, N, shift_);
+#endif
+    }
+#ifdef TOUCH_FIR_VECTOR
+    const Lane* newer = buffer_ + act_ + N;
+    const Lane* older = newer - (N - 1);
+    Lane sum = newer[0] * (uint32_t)pgm_read_byte(q_) + *(newer - N/2) * (uint32_t)pgm_read_byte(q_ + N/2);
+    for (uint16_t i = 1; i < N/2; i++) {
+      sum += (*--newer + *older++) * (uint32_t)pgm_read_byte(q_ + i);
+    }
+    sum = (sum + (uint32_t)(1UL << shift_ >> 1)) >> shift_;
+    for (uint8_t l = 0; l < Lanes; l++) val[l] = sum[l];
+#else
+    for (uint8_t l = 0; l < Lanes; l++) {
+      const T (*newer)[Lanes] = buffer_ + act_ + N;
+      const T (*older)[Lanes] = newer - (N - 1);
+      uint32_t sum = (uint32_t)newer[0][l] * pgm_read_byte(q_) + (uint32_t)(newer - N/2)[0][l] * pgm_read_byte(q_ + N/2);
+      for (uint16_t i = 1; i < N/2; i++) {
+        --newer;
+        sum += ((uint32_t)newer[0][l] + older[0][l]) * pgm_read_byte(q_ + i);
+        ++older;
+      }
+      val[l] = (sum + (1UL << shift_ >> 1)) >> shift_;
+    }
+#endif
+    act_++;
+    if (act_ >= N) act_ = 0;
+
+    return true;
+  }
+
+  inline void reset()
+  {
+    filled_ = 0;
+    act_ = 0;
+  }
+
+  inline uint16_t size() const
+  {
+    return N;
+  }
+
+  inline uint16_t filled() const
+  {
+    return filled_;
+  }
+
+/**
+  * Without warm start next() gives no result until N values are filtered.
+  * With warm start the first value after reset() fill the whole filter, a result is available at once
+  * and converge to the filtered value within N values.
+  * @brief  set warm start
+  * @param  warm_start true: fill filter with first value
+  */
+  inline void setWarmStart(bool warm_start)
+  {
+    warm_start_ = warm_start;
+  }
+
+  inline bool getWarmStart() const
+  {
+    return warm_start_;
+  }
+
+  inline uint8_t lanes() const
+  {
+    return Lanes;
+  }
+
+private:
+#ifdef TOUCH_FIR_VECTOR
+  typedef typename FirLanes<Lanes>::type Lane; ///< all channels of one point in time
+  Lane buffer_[2*N]; ///< every point twice, at act_ and act_ + N
+#else
+  T buffer_[2*N][Lanes]; ///< every point twice, at act_ and act_ + N
+#endif
+  const uint8_t* q_; ///< coefficients in flash, see FirWindow
+  uint8_t shift_; ///< normalization of the weighted sum
+  bool warm_start_; ///< first value fill the filter
   uint16_t filled_;
   uint16_t act_;
 };
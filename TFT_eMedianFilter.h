@@ -0,0 +1,206 @@
+#ifndef TFT_E_MEDIAN_FILTER_H
+#define TFT_E_MEDIAN_FILTER_H
+
+//
+//  TFT_eMedianFilter.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+/** 
+  * Streaming median of the last N values. The window is kept sorted, a new value replace the oldest
+  * with a binary search and a shift of the values between them (no sort per value).
+  * Same interface as FirFilter, can be used as TOUCH_X_FILTER, TOUCH_Y_FILTER or TOUCH_Z_FILTER.
+  * @brief  median filter
+  * @param  N window size, must be odd
+  * @param  T used data type
+  */
+template <uint8_t N = 5, class T = uint16_t>
+class MedianFilter
+{
+  static_assert(N >= 3 && (N & 1) == 1, "N must be odd");
+
+public:
+  MedianFilter(uint8_t filter = 0, bool warm_start = false)
+  : warm_start_(warm_start)
+  {
+    (void)filter; // no window type
+    reset();
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value, replaced by the median of the last N values
+  * @return false while not filled, val is unchanged then
+  */
+  bool filter(T& val)
+  {
+    if (filled_ == 0 && warm_start_) { // first value fill the filter, see FirFilter
+      for (uint8_t i = 0; i < N; i++) {
+        ring_[i] = val;
+        sorted_[i] = val;
+      }
+      filled_ = N;
+    }
+    if (filled_ < N) {
+      ring_[act_++] = val;
+      uint8_t pos = filled_++;
+      while (pos > 0 && sorted_[pos - 1] > val) {
+        sorted_[pos] = sorted_[pos - 1];
+        pos--;
+      }
+      sorted_[pos] = val;
+      if (act_ >= N) act_ = 0;
+      if (filled_ < N) return false;
+      val = sorted_[N/2];
+      return true;
+    }
+    T old = ring_[act_];
+    ring_[act_++] = val;
+    if (act_ >= N) act_ = 0;
+
+    uint8_t pos = find(old);
+    if (val > old) {
+      while (pos < N - 1 && sorted_[pos + 1] < val) {
+        sorted_[pos] = sorted_[pos + 1];
+        pos++;
+      }
+    }
+    else {
+      while (pos > 0 && sorted_[pos - 1] > val) {
+        sorted_[pos] = sorted_[pos - 1];
+        pos--;
+      }
+    }
+    sorted_[pos] = val;
+    val = sorted_[N/2];
+    return true;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value
+  * @return median of the last N values, 0 while not filled
+  */
+  T next(T val)
+  {
+    return filter(val) ? val : 0;
+  }
+
+  inline void reset()
+  {
+    filled_ = 0;
+    act_ = 0;
+  }
+
+  inline uint16_t size() const
+  {
+    return N;
+  }
+
+  inline uint16_t filled() const
+  {
+    return filled_;
+  }
+
+  inline void setWarmStart(bool warm_start)
+  {
+    warm_start_ = warm_start;
+  }
+
+  inline bool getWarmStart() const
+  {
+    return warm_start_;
+  }
+
+protected:
+  /// position of val in sorted_ (binary search)
+  uint8_t find(T val) const
+  {
+    uint8_t lo = 0, hi = N - 1;
+    while (lo < hi) {
+      uint8_t mid = (lo + hi) / 2;
+      if (sorted_[mid] < val) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  T ring_[N];   ///< values in arrival order
+  T sorted_[N]; ///< the same values sorted
+  bool warm_start_; ///< first value fill the filter
+  uint8_t filled_;
+  uint8_t act_;
+};
+
+/** 
+  * Hampel identifier: a value further than K·1.5·MAD (median absolute deviation, 1.5 approximates 1.4826)
+  * from the median of the last N values is an outlier and replaced by the median, other values pass unchanged.
+  * Unlike a fir filter a spike is removed and not smeared into the next values, and there is no delay.
+  * @brief  spike rejection filter
+  * @param  N window size, must be odd
+  * @param  K threshold in MAD
+  * @param  MinDev a deviation up to MinDev is never an outlier (MAD is 0 on a steady pen)
+  * @param  T used data type
+  */
+template <uint8_t N = 7, uint8_t K = 3, uint16_t MinDev = 8, class T = uint16_t>
+class HampelFilter : public MedianFilter<N, T>
+{
+  typedef MedianFilter<N, T> Median;
+
+public:
+  HampelFilter(uint8_t filter = 0, bool warm_start = false)
+  : Median(filter, warm_start)
+  {
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value, replaced by the median of the last N values when it is a outlier
+  * @return false while not filled, val is unchanged then
+  */
+  bool filter(T& val)
+  {
+    T med = val;
+    if (!Median::filter(med)) return false;
+
+    // the deviations below and above the median are sorted, merge them up to the middle
+    uint8_t lo = N/2, hi = N/2;
+    uint32_t mad = 0;
+    for (uint8_t i = 0; i < N/2; i++) {
+      uint32_t dev_lo = lo > 0 ? med - Median::sorted_[lo - 1] : 0xffffffff;
+      uint32_t dev_hi = hi < N - 1 ? Median::sorted_[hi + 1] - med : 0xffffffff;
+      if (dev_lo <= dev_hi) {
+        mad = dev_lo;
+        lo--;
+      }
+      else {
+        mad = dev_hi;
+        hi++;
+      }
+    }
+    uint32_t limit = mad * K * 3 / 2;
+    if (limit < MinDev) limit = MinDev;
+    uint32_t dev = val > med ? val - med : med - val;
+    if (dev > limit) val = med;
+    return true;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value
+  * @return val or median of the last N values when val is a outlier, 0 while not filled
+  */
+  T next(T val)
+  {
+    return filter(val) ? val : 0;
+  }
+};
+
+#endif // TFT_E_MEDIAN_FILTER_H
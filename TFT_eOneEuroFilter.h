@@ -0,0 +1,150 @@
+#ifndef TFT_E_ONE_EURO_FILTER_H
+#define TFT_E_ONE_EURO_FILTER_H
+
+//
+//  TFT_eOneEuroFilter.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+
+/** 
+  * Low pass filter with a cutoff frequency rising with the pen speed (1€ filter, Casiez et al.).
+  * A resting pen is smoothed with min_cutoff, a moving pen is followed with little delay.
+  * - cutoff = min_cutoff + beta * speed / 256 (cutoff in 0.01 Hz, speed in raw/s filtered with d_cutoff)
+  * - alpha = 1 / (1 + 1 / (2 * pi * cutoff * dt)), dt from micros() between the calls
+  *
+  * Fixed point only (alpha in Q15, value in 1/16 raw), two 32 bit divisions per value, values up to 4095.
+  * The first value after reset() or a pause longer than 100 ms is given back unchanged, there is no fill time.
+  * Same interface as FirFilter, can be used as TOUCH_X_FILTER, TOUCH_Y_FILTER or TOUCH_Z_FILTER.
+  * @brief  speed adaptive low pass filter
+  * @param  T used data type
+  */
+template <class T = uint16_t>
+class OneEuroFilter
+{
+public:
+  OneEuroFilter(uint8_t filter = 0, bool warm_start = false)
+  : x_(0)
+  , dx_(0)
+  , last_us_(0)
+  , min_cutoff_(100)
+  , beta_(50)
+  , d_cutoff_(100)
+  {
+    (void)filter; // no window type
+    (void)warm_start; // always warm
+    reset();
+  }
+
+/**
+  * @brief  set filter parameter
+  * @param  min_cutoff cutoff of a resting pen in 0.01 Hz, lower is smoother (default 1 Hz)
+  * @param  beta cutoff increase in 0.01 Hz per 256 raw/s, higher is less lag when moving (default 50)
+  * @param  d_cutoff cutoff of the speed in 0.01 Hz (default 1 Hz)
+  */
+  void setParameter(uint16_t min_cutoff, uint16_t beta, uint16_t d_cutoff = 100)
+  {
+    min_cutoff_ = min_cutoff;
+    beta_ = beta;
+    d_cutoff_ = d_cutoff;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value, replaced by the filtered value
+  * @return always true, there is no fill time
+  */
+  bool filter(T& val)
+  {
+    uint32_t now = micros();
+    uint32_t dt = 0;
+    if (filled_) dt = now - last_us_; // last_us_ is set by the first value
+    last_us_ = now;
+    int32_t val16 = (int32_t)val << 4;
+    if (filled_ == 0 || dt > 100000) { // first value or pen was lifted
+      x_ = val16;
+      dx_ = 0;
+      filled_ = 1;
+      return true;
+    }
+    if (dt < 100) dt = 100;
+
+    // speed in raw/s, 1/16 raw * 1000000 / dt
+    int32_t dx = (val16 - x_) * 15625 / (int32_t)(dt >> 2);
+    if (dx > 32767) dx = 32767;
+    else if (dx < -32767) dx = -32767;
+    dx_ += alpha(d_cutoff_, dt) * (dx - dx_) >> 15;
+
+    uint32_t cutoff = min_cutoff_ + ((uint32_t)beta_ * (uint32_t)(dx_ < 0 ? -dx_ : dx_) >> 8);
+    if (cutoff > 0xffff) cutoff = 0xffff;
+    x_ += alpha(cutoff, dt) * (val16 - x_) >> 15;
+    val = (T)((x_ + 8) >> 4);
+    return true;
+  }
+
+/**
+  * @brief  filter next value
+  * @param  val new value
+  * @return filtered value
+  */
+  T next(T val)
+  {
+    filter(val);
+    return val;
+  }
+
+  inline void reset()
+  {
+    x_ = 0;
+    dx_ = 0;
+    last_us_ = 0;
+    filled_ = 0;
+  }
+
+  inline uint16_t size() const
+  {
+    return 1;
+  }
+
+  inline uint16_t filled() const
+  {
+    return filled_;
+  }
+
+  inline void setWarmStart(bool)
+  {
+  }
+
+  inline bool getWarmStart() const
+  {
+    return true;
+  }
+
+private:
+  /// Q15 smoothing factor of cutoff (0.01 Hz) for dt (us), w / (1 + w) with w = cutoff * dt * 2 * pi / 10^8
+  static int32_t alpha(uint32_t cutoff, uint32_t dt)
+  {
+    if (cutoff == 0) return 0;
+    if (dt > 0xffffffffUL / cutoff) return 32768;
+    uint32_t p = cutoff * dt;
+    return p / ((p >> 15) + 486); // 10^8 / (2 * pi) / 32768 = 485.7
+  }
+
+  int32_t  x_;   ///< filtered value in 1/16 raw
+  int32_t  dx_;  ///< filtered speed in raw/s
+  uint32_t last_us_;
+  uint16_t min_cutoff_;
+  uint16_t beta_;
+  uint16_t d_cutoff_;
+  uint8_t  filled_;
+};
+
+#endif // TFT_E_ONE_EURO_FILTER_H
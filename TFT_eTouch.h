@@ -15,6 +15,10 @@
 
 #include <TFT_eTouchBase.h>
 
+#ifdef TOUCH_USE_PREDICTION
+#include <TFT_eTouchKalman.h>
+#endif
+
 /** 
   * @brief  touch support for tft
   * @param  T used display driver, must be Adafuit compatible
@@ -97,14 +101,91 @@ public:
   * @return true when display is tuched
   */
   bool      get(TouchPoint& tp);
+
+#ifdef TOUCH_USE_PREDICTION
+/** 
+  * Every position of getXY() and get() updates a Kalman tracker per axis, it estimates the pen velocity.
+  * Predict where the pen will be when a frame drawn now is visible, this hides the delay of fetch, filter and drawing.
+  * The values x and y are only set if the function returns true.
+  * @brief  predicted display position
+  * @param  x predicted display coordinate
+  * @param  y predicted display coordinate
+  * @param  ms_ahead time from now
+  * @return true when the last getXY() or get() was touched
+  */
+  bool      predict(int16_t& x, int16_t& y, uint16_t ms_ahead);
+
+/** 
+  * @brief  set noise of the prediction tracker
+  * @param  measure standard deviation of the position in 1/16 pixel (default 8)
+  * @param  accel standard deviation of the pen acceleration in 1/256 pixel/ms² (default 4), higher follow direction changes faster
+  * @sa TouchKalman
+  */
+  void      setPredictionNoise(uint16_t measure, uint16_t accel);
+#endif // end TOUCH_USE_PREDICTION
   
-#ifdef TOUCH_USE_PENIRQ_CODE
-# ifdef ESP32
-  static void IRAM_ATTR cb_isr_touch_fnk();
-# else
-  static void cb_isr_touch_fnk();
-# endif
-#endif // end TOUCH_USE_PENIRQ_CODE
+#ifdef TOUCH_USE_TASK
+/** 
+  * Start a FreeRTOS task owning the touch controller. Every getMeasureWait() milliseconds the task fetch, filter and transform the touch
+  * and post pen_down, move and pen_up events to a queue, read them with getEvent(). When penirq is used the task sleep until the display is touched.
+  *
+  * All spi transfers of the touch take busMutex(), when none is set a mutex is created. The display driver has to take this mutex around its drawing.
+  * Do not call getXY(), get(), getRaw() or reset() while the task is running.
+@code
+touch.startTask(0); // touch on core 0, loop() with display on core 1
+
+void loop() {
+  TFT_eTouchBase::TouchEvent ev;
+  while (touch.getEvent(ev)) {
+    // handle ev.type at ev.tp
+  }
+  xSemaphoreTake(touch.busMutex(), portMAX_DELAY);
+  // draw frame
+  xSemaphoreGive(touch.busMutex());
+}
+@endcode
+  * @brief  start touch task
+  * @param  core core the task is pinned to
+  * @param  priority FreeRTOS priority of the task
+  * @param  queue_size number of events the queue can hold
+  * @return true when task is running
+  */
+  bool      startTask(BaseType_t core = 0, UBaseType_t priority = 2, uint8_t queue_size = 8);
+
+/** 
+  * The task finish its actual fetch and is deleted.
+  * @brief  stop touch task
+  */
+  void      stopTask();
+
+/** 
+  * Get the oldest event of the touch task.
+  * @brief  get event
+  * @param  ev event, only set when the function returns true
+  * @param  wait_ms maximal time to wait for an event
+  * @return true when a event was available
+  */
+  bool      getEvent(TouchEvent& ev, uint32_t wait_ms = 0);
+#endif // end TOUCH_USE_TASK
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+/** 
+  * Fetch only while the display driver has no DMA transfer running, T must have dmaBusy() (TFT_eSPI with DMA).
+  * For other drivers use setDisplayBusy() with an own function. Call frameDone() after pushing a frame.
+@code
+touch.syncDisplayDma();
+
+void loop() {
+  tft.pushImageDMA(0, 0, w, h, frame);
+  if (touch.getXY(x, y)) { ... } // queued while DMA is running
+  tft.dmaWait();
+  touch.frameDone(); // queued fetch
+}
+@endcode
+  * @brief  sync with display DMA
+  */
+  void      syncDisplayDma();
+#endif // end TOUCH_USE_DISPLAY_SYNC
 
 private:
 #ifdef TOUCH_USE_USER_CALIBRATION
@@ -121,10 +202,26 @@ private:
   bool      handleTouchCalibrationTarget(CalibrationPoint& point);
 #endif
 
+#ifdef TOUCH_USE_TASK
+  static void task_fnk(void* arg); ///< FreeRTOS task function
+  void      task_loop(); ///< fetch touch and post events until task_stop_
+
+  QueueHandle_t events_; ///< posted events
+  volatile bool task_stop_; ///< request task to stop
+#endif // end TOUCH_USE_TASK
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  static bool display_dma_busy(void* tft); ///< DisplayBusyFnk calling T::dmaBusy()
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
+#ifdef TOUCH_USE_PREDICTION
+  void      track(const TouchPoint* tp); ///< update trackers with tp, reset them when 0
+
+  TouchKalman track_x_; ///< x tracker for predict()
+  TouchKalman track_y_; ///< y tracker for predict()
+#endif // end TOUCH_USE_PREDICTION
+
   T& tft_; ///< the given display driver
-#ifdef TOUCH_USE_PENIRQ_CODE
-  static TFT_eTouch<T>* isr_instance_; ///< one instance used for interrupt handling
-#endif // end TOUCH_USE_PENIRQ_CODE
 };
 
 #include <TFT_eTouch.inl>
@@ -13,26 +13,13 @@
 //  See TFT_eTouch/docs/html/index.html for documentation.
 //
 
-#ifdef TOUCH_USE_PENIRQ_CODE
-template <class T>
-TFT_eTouch<T>* TFT_eTouch<T>::isr_instance_ = 0;
-
-template <class T>
-#ifdef ESP32
-void IRAM_ATTR TFT_eTouch<T>::cb_isr_touch_fnk()
-#else
-void TFT_eTouch<T>::cb_isr_touch_fnk()
-#endif
-{
-	TFT_eTouch<T>* touch_ptr = isr_instance_;
-  if (touch_ptr) touch_ptr->update_allowed_ = true;
-}
-#endif // end TOUCH_USE_PENIRQ_CODE
-
-
 template <class T>
 TFT_eTouch<T>::TFT_eTouch(T& tft, uint8_t cs_pin, uint8_t penirq_pin, SPIClass& spi)
 : TFT_eTouchBase(cs_pin, penirq_pin, spi)
+#ifdef TOUCH_USE_TASK
+, events_(0)
+, task_stop_(false)
+#endif // end TOUCH_USE_TASK
 , tft_(tft)
 {
 }
@@ -48,11 +35,7 @@ void TFT_eTouch<T>::init()
 {
   TFT_eTouchBase::init(false);
 #ifdef TOUCH_USE_PENIRQ_CODE
-  if (penirq_ != 0xff) {
-    pinMode(penirq_, INPUT);
-    attachInterrupt(digitalPinToInterrupt(penirq_), cb_isr_touch_fnk, FALLING);
-    isr_instance_ = this;
-  }
+  attach_penirq();
 #endif // end TOUCH_USE_PENIRQ_CODE
 }
 
@@ -181,6 +164,7 @@ bool TFT_eTouch<T>::getUserCalibration(Calibation& data, uint8_t xy_off)
   data.y1 = (tft_.height() - 1 - y0) * d_yt / d_ys;
 
   data.rel_rotation = (user_r + touch_r) % 4;
+  data.spi_clock = calibation_.spi_clock;
   
 #ifdef TOUCH_SERIAL_DEBUG
   if (Serial) {
@@ -191,8 +175,8 @@ bool TFT_eTouch<T>::getUserCalibration(Calibation& data, uint8_t xy_off)
 #endif
 
   if (Serial) {
-    Serial.printf("#define TOUCH_DEFAULT_CALIBRATION { %i, %i, %i, %i, %i }\n",
-      data.x0, data.x1, data.y0, data.y1, data.rel_rotation);
+    Serial.printf("#define TOUCH_DEFAULT_CALIBRATION { %i, %i, %i, %i, %i, %i }\n",
+      data.x0, data.x1, data.y0, data.y1, data.rel_rotation, data.spi_clock);
   }
 
   return true;
@@ -208,7 +192,7 @@ acurate on p[315, 235] is 100, dx 152, dy 113
 acurate on p[315, 235] is 100, dx 189, dy 129
 acurate on p[315, 235] is 100, dx 93, dy 68
 acurate on p[4, 235] is 100, dx 54, dy 7
-#define TOUCH_DEFAULT_CALIBRATION { 263, 3765, 3873, 326, 0 }
+#define TOUCH_DEFAULT_CALIBRATION { 263, 3765, 3873, 326, 0, 0 }
 */
 
 #endif // TOUCH_USE_USER_CALIBRATION
@@ -216,40 +200,15 @@ acurate on p[4, 235] is 100, dx 54, dy 7
 template <class T>
 bool TFT_eTouch<T>::transform(const Measure& raw, TouchPoint& tp)
 {
+#ifdef TOUCH_USE_STATS
+  TouchStatsTimer timer(stats_.transform);
+#endif // end TOUCH_USE_STATS
   if (raw.rz != 0xffff) {
-    uint8_t d_rot = (4 + tft_.getRotation() - calibation_.rel_rotation) % 4;
-
-    int16_t dx = calibation_.x1 - calibation_.x0;
-    int16_t dy = calibation_.y1 - calibation_.y0;
-
-    int16_t xs=0, xs_max = tft_.width() - 1;
-    int16_t ys=0, ys_max = tft_.height() - 1;
-
-    switch (d_rot) {
-    case 0:
-      xs = (raw.x - calibation_.x0) * xs_max / dx;
-      ys = (raw.y - calibation_.y0) * ys_max / dy;
-      break;
-    case 1:
-      xs = (raw.y - calibation_.y0) * xs_max / dy;
-      ys = ys_max - ((raw.x - calibation_.x0) * ys_max / dx);
-      break;
-    case 2:
-      xs = xs_max - ((raw.x - calibation_.x0) * xs_max / dx);
-      ys = ys_max - ((raw.y - calibation_.y0) * ys_max / dy);
-      break;
-    case 3:
-      xs = xs_max - ((raw.y - calibation_.y0) * xs_max / dy);
-      ys = (raw.x - calibation_.x0) * ys_max / dx;
-      break;
+    uint8_t rotation = tft_.getRotation();
+    if (rotation != transform_rotation_) { // divisions only when rotation or calibration changed
+      update_transform(rotation, tft_.width(), tft_.height());
     }
-    if (xs < 0) xs = 0;
-    if (xs > xs_max) xs = xs_max;
-
-    if (ys < 0) ys = 0;
-    if (ys > ys_max) ys = ys_max;
-    
-    tp.set(xs, ys, raw.rz);
+    tp.set(transform_axis(transform_[0], raw), transform_axis(transform_[1], raw), raw.rz);
     return true;
   }
   tp.rz = 0xffff;
@@ -265,9 +224,15 @@ bool TFT_eTouch<T>::getXY(int16_t& x, int16_t& y)
     transform(raw_, tp);
     x = tp.x;
     y = tp.y;
+#ifdef TOUCH_USE_PREDICTION
+    track(&tp);
+#endif // end TOUCH_USE_PREDICTION
 
     return true;
   }
+#ifdef TOUCH_USE_PREDICTION
+  track(0);
+#endif // end TOUCH_USE_PREDICTION
   return false;
 }
 
@@ -276,11 +241,161 @@ bool TFT_eTouch<T>::get(TouchPoint& tp)
 {
   update(false);
   if (valid()) {
+#ifdef TOUCH_USE_PREDICTION
+    bool ret = transform(raw_, tp);
+    track(&tp);
+    return ret;
+#else
     return transform(raw_, tp);
+#endif // end TOUCH_USE_PREDICTION
   }
+#ifdef TOUCH_USE_PREDICTION
+  track(0);
+#endif // end TOUCH_USE_PREDICTION
   return false;
 }
 
+#ifdef TOUCH_USE_PREDICTION
+template <class T>
+bool TFT_eTouch<T>::predict(int16_t& x, int16_t& y, uint16_t ms_ahead)
+{
+  if (!track_x_.tracking()) return false;
+  uint32_t us_ahead = micros() - track_x_.lastUpdate() + ms_ahead * 1000UL;
+  int16_t xs = track_x_.predict(us_ahead);
+  int16_t ys = track_y_.predict(us_ahead);
+  int16_t xs_max = tft_.width() - 1;
+  int16_t ys_max = tft_.height() - 1;
+  x = xs < 0 ? 0 : xs > xs_max ? xs_max : xs;
+  y = ys < 0 ? 0 : ys > ys_max ? ys_max : ys;
+  return true;
+}
+
+template <class T>
+void TFT_eTouch<T>::setPredictionNoise(uint16_t measure, uint16_t accel)
+{
+  track_x_.setNoise(measure, accel);
+  track_y_.setNoise(measure, accel);
+}
+
+template <class T>
+void TFT_eTouch<T>::track(const TouchPoint* tp)
+{
+  if (tp) {
+    uint32_t us = micros();
+    track_x_.update(tp->x, us);
+    track_y_.update(tp->y, us);
+  }
+  else {
+    track_x_.reset();
+    track_y_.reset();
+  }
+}
+#endif // end TOUCH_USE_PREDICTION
+
+#ifdef TOUCH_USE_TASK
+template <class T>
+bool TFT_eTouch<T>::startTask(BaseType_t core, UBaseType_t priority, uint8_t queue_size)
+{
+  if (task_) return true;
+  if (!bus_mutex_) bus_mutex_ = xSemaphoreCreateMutex();
+  if (!events_) events_ = xQueueCreate(queue_size, sizeof(TouchEvent));
+  if (!bus_mutex_ || !events_) {
+    if (Serial) Serial.println("TFT_eTouch::startTask() could not allocate mutex or queue");
+    return false;
+  }
+  task_stop_ = false;
+  if (xTaskCreatePinnedToCore(task_fnk, "TFT_eTouch", 3072, this, priority, &task_, core) != pdPASS) {
+    task_ = 0;
+    if (Serial) Serial.println("TFT_eTouch::startTask() could not create task");
+    return false;
+  }
+  return true;
+}
+
+template <class T>
+void TFT_eTouch<T>::stopTask()
+{
+  if (!task_) return;
+  task_stop_ = true;
+  xTaskNotifyGive(task_); // when sleeping on penirq
+  while (task_) vTaskDelay(1);
+}
+
+template <class T>
+bool TFT_eTouch<T>::getEvent(TouchEvent& ev, uint32_t wait_ms)
+{
+  if (!events_) return false;
+  return xQueueReceive(events_, &ev, pdMS_TO_TICKS(wait_ms)) == pdTRUE;
+}
+
+template <class T>
+void TFT_eTouch<T>::task_fnk(void* arg)
+{
+  TFT_eTouch<T>* touch_ptr = static_cast<TFT_eTouch<T>*>(arg);
+  touch_ptr->task_loop();
+  touch_ptr->task_ = 0;
+  vTaskDelete(0);
+}
+
+template <class T>
+void TFT_eTouch<T>::task_loop()
+{
+  TouchEvent ev;
+  bool down = false;
+  TickType_t wake = xTaskGetTickCount();
+  while (!task_stop_) {
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+    TickType_t ticks = pdMS_TO_TICKS(getEffectiveWait());
+#else
+    TickType_t ticks = pdMS_TO_TICKS(getMeasureWait());
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+    vTaskDelayUntil(&wake, ticks > 0 ? ticks : 1);
+#ifdef TOUCH_USE_PENIRQ_CODE
+    if (!down && !update_allowed_) { // sleep until touched
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      wake = xTaskGetTickCount();
+      continue;
+    }
+#endif // end TOUCH_USE_PENIRQ_CODE
+#ifdef TOUCH_USE_DISPLAY_SYNC
+    while (display_busy()) vTaskDelay(1); // fetch between display transfers
+#endif // end TOUCH_USE_DISPLAY_SYNC
+    fetch(false);
+    ev.ms = millis();
+    if (valid()) {
+      TouchPoint tp;
+      transform(raw_, tp);
+      if (!down || tp.x != ev.tp.x || tp.y != ev.tp.y) {
+        ev.type = down ? TouchEvent::move : TouchEvent::pen_down;
+        ev.tp = tp;
+        xQueueSend(events_, &ev, 0); // drop event when queue is full
+        down = true;
+      }
+    }
+    else if (down) {
+      ev.type = TouchEvent::pen_up;
+      xQueueSend(events_, &ev, 0);
+      down = false;
+      reset(); // empty filter
+    }
+  }
+}
+#endif // end TOUCH_USE_TASK
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+template <class T>
+void TFT_eTouch<T>::syncDisplayDma()
+{
+  setDisplayBusy(display_dma_busy, &tft_);
+}
+
+template <class T>
+bool TFT_eTouch<T>::display_dma_busy(void* tft)
+{
+  return static_cast<T*>(tft)->dmaBusy();
+}
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
 // private
 #ifdef TOUCH_USE_USER_CALIBRATION
 
@@ -22,16 +22,30 @@
 
 #include <TFT_eTouchBase.h>
 
+#ifdef TOUCH_USE_LOG
+TouchLog<TOUCH_LOG_SIZE> touch_log;
+#endif // end TOUCH_USE_LOG
+
 TFT_eTouchBase::TFT_eTouchBase(uint8_t cs_pin, uint8_t penirq_pin, SPIClass& spi)
 : spi_(spi)
 , cs_(cs_pin)
 , penirq_(penirq_pin)
+, transform_rotation_(0xff)
+, spi_clock_(TOUCH_SPI_CLOCK)
+, spi_settings_(TOUCH_SPI_CLOCK, MSBFIRST, SPI_MODE0)
 //, raw_.x(0), raw_.y(0)
 //, raw_z1_(0), raw_z2_(0)
 //, rz_(0xffff)
+#ifdef TOUCH_USE_TRACE
+, trace_(0)
+#endif // end TOUCH_USE_TRACE
 #ifdef TOUCH_USE_PENIRQ_CODE
 , update_allowed_(true)
 #endif // end TOUCH_USE_PENIRQ_CODE
+#ifdef TOUCH_USE_TASK
+, bus_mutex_(0)
+, task_(0)
+#endif // end TOUCH_USE_TASK
 , drop_first_measures_(0)
 , z_once_measure_(false)
 , z_first_measure_(true)
@@ -42,38 +56,144 @@ TFT_eTouchBase::TFT_eTouchBase(uint8_t cs_pin, uint8_t penirq_pin, SPIClass& spi
 , ignore_min_max_measure_(false)
 #endif // end TOUCH_USE_AVERAGING_CODE
 
+, conversion_mode_(0)
 , raw_valid_min_(25), raw_valid_max_(4000)
 , last_measure_time_us_(0), measure_wait_ms_(5)
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+, adaptive_min_ms_(5), adaptive_max_ms_(0), adaptive_idle_ms_(50), adaptive_move_(8)
+, effective_wait_ms_(5), adaptive_x_(0), adaptive_y_(0), adaptive_touched_(false)
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+#ifdef TOUCH_USE_DISPLAY_SYNC
+, display_busy_fnk_(0), display_busy_ctx_(0), fetch_pending_(0)
+#endif // end TOUCH_USE_DISPLAY_SYNC
 , rx_plate_(1000/3)
 , rz_threshold_(1000)
+#ifdef TOUCH_USE_ASYNC_UPDATE
+, async_update_(false)
+, acquire_step_(0)
+#endif // end TOUCH_USE_ASYNC_UPDATE
+#ifdef TOUCH_USE_BUS
+, bus_owned_(false)
+#endif // end TOUCH_USE_BUS
+#ifdef TOUCH_USE_SAMPLER
+, sampler_overruns_(0)
+, sampler_running_(false)
+# ifdef ESP32
+, sampler_timer_(0)
+# endif
+#endif // end TOUCH_USE_SAMPLER
 #ifdef TOUCH_USE_USER_CALIBRATION
 , acurate_difference_(10)
 #endif // TOUCH_USE_USER_CALIBRATION
+#ifdef TOUCH_FILTER_TYPE
+# ifdef TOUCH_X_FILTER
+, x_filter_(TOUCH_FILTER_TYPE, TOUCH_FILTER_WARM_START)
+# endif
+# ifdef TOUCH_Y_FILTER
+, y_filter_(TOUCH_FILTER_TYPE, TOUCH_FILTER_WARM_START)
+# endif
+# ifdef TOUCH_Z_FILTER
+, z1_filter_(TOUCH_FILTER_TYPE, TOUCH_FILTER_WARM_START)
+, z2_filter_(TOUCH_FILTER_TYPE, TOUCH_FILTER_WARM_START)
+# endif
+# ifdef TOUCH_FILTER_BANK
+, filter_bank_(TOUCH_FILTER_TYPE, TOUCH_FILTER_WARM_START)
+# endif
+#endif // end TOUCH_FILTER_TYPE
 {
+#ifdef TOUCH_MEASURE_POLICY
+  drop_first_measures_ = TOUCH_MEASURE_POLICY::drop(); // used by batch and async fetch
+  z_once_measure_ = TOUCH_MEASURE_POLICY::z_once();
+  z_first_measure_ = TOUCH_MEASURE_POLICY::z_first();
+  z_local_min_measure_ = TOUCH_MEASURE_POLICY::z_local_min();
+  count_measure_ = TOUCH_MEASURE_POLICY::count();
+# ifdef TOUCH_USE_AVERAGING_CODE
+  averaging_measure_ = TOUCH_MEASURE_POLICY::averaging();
+  ignore_min_max_measure_ = TOUCH_MEASURE_POLICY::ignore_min_max();
+# endif // end TOUCH_USE_AVERAGING_CODE
+#else
+  compile_program();
+#endif // end TOUCH_MEASURE_POLICY
   calibation_ = TOUCH_DEFAULT_CALIBRATION;
+  setSPIClock(calibation_.spi_clock * 100000UL);
+}
 
-#ifdef TOUCH_FILTER_TYPE
-# ifdef TOUCH_X_FILTER 
-  x_filter_ = new TOUCH_X_FILTER(TOUCH_FILTER_TYPE);
-  if (!x_filter_ && Serial) {
-    Serial.println("coult not allocate x_filter");
-  }
-# endif
-# ifdef TOUCH_Y_FILTER 
-  y_filter_ = new TOUCH_Y_FILTER(TOUCH_FILTER_TYPE);
-  if (!y_filter_ && Serial) {
-    Serial.println("coult not allocate y_filter");
+#ifdef TOUCH_USE_PENIRQ_CODE
+TFT_eTouchBase::~TFT_eTouchBase()
+{
+  for (uint8_t i = 0; i < TOUCH_MAX_INSTANCES; i++) {
+    if (isr_instances_[i] == this) {
+      detachInterrupt(digitalPinToInterrupt(penirq_));
+      isr_instances_[i] = 0;
+    }
   }
-# endif
-# ifdef TOUCH_Z_FILTER 
-  z1_filter_ = new TOUCH_Z_FILTER(TOUCH_FILTER_TYPE);
-  z2_filter_ = new TOUCH_Z_FILTER(TOUCH_FILTER_TYPE);
-  if ((!z1_filter_ || !z2_filter_) && Serial) {
-    Serial.println("coult not allocate z_filter");
+}
+
+TFT_eTouchBase* volatile TFT_eTouchBase::isr_instances_[TOUCH_MAX_INSTANCES];
+
+template <uint8_t N>
+#ifdef ESP32
+void IRAM_ATTR TFT_eTouchBase::cb_isr_touch_fnk()
+#else
+void TFT_eTouchBase::cb_isr_touch_fnk()
+#endif
+{
+  TFT_eTouchBase* touch_ptr = isr_instances_[N];
+  if (touch_ptr) {
+    touch_ptr->update_allowed_ = true;
+#ifdef TOUCH_USE_STATS
+    touch_ptr->stats_.penirq_wakeups++;
+#endif // end TOUCH_USE_STATS
+#ifdef TOUCH_USE_LOG
+    TOUCH_LOG(log_penirq, touch_ptr->penirq_);
+#endif // end TOUCH_USE_LOG
+#ifdef TOUCH_USE_TASK
+    if (touch_ptr->task_) { // wake up sleeping touch task
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(touch_ptr->task_, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    }
+#endif // end TOUCH_USE_TASK
   }
-# endif
+}
+
+#if (TOUCH_MAX_INSTANCES < 1) || (TOUCH_MAX_INSTANCES > 4)
+#error "TOUCH_MAX_INSTANCES must be 1..4"
 #endif
+
+void (* const TFT_eTouchBase::isr_fnk_[TOUCH_MAX_INSTANCES])() = {
+  cb_isr_touch_fnk<0>
+#if TOUCH_MAX_INSTANCES > 1
+  , cb_isr_touch_fnk<1>
+#endif
+#if TOUCH_MAX_INSTANCES > 2
+  , cb_isr_touch_fnk<2>
+#endif
+#if TOUCH_MAX_INSTANCES > 3
+  , cb_isr_touch_fnk<3>
+#endif
+};
+
+bool TFT_eTouchBase::attach_penirq()
+{
+  if (penirq_ == 0xff) return true;
+  uint8_t free = TOUCH_MAX_INSTANCES;
+  for (uint8_t i = 0; i < TOUCH_MAX_INSTANCES; i++) {
+    if (isr_instances_[i] == this) return true; // already attached
+    if (!isr_instances_[i] && free == TOUCH_MAX_INSTANCES) free = i;
+  }
+  if (free == TOUCH_MAX_INSTANCES) {
+    if (Serial) Serial.println("TFT_eTouchBase::attach_penirq() dispatch table full, increase TOUCH_MAX_INSTANCES");
+    penirq_ = 0xff; // fetch without penirq
+    update_allowed_ = true;
+    return false;
+  }
+  isr_instances_[free] = this;
+  pinMode(penirq_, INPUT);
+  attachInterrupt(digitalPinToInterrupt(penirq_), isr_fnk_[free], FALLING);
+  return true;
 }
+#endif // end TOUCH_USE_PENIRQ_CODE
 
 void TFT_eTouchBase::init(bool spi_init)
 {
@@ -130,6 +250,14 @@ void TFT_eTouchBase::waitPenUp()
 }
 
 
+// spi clocks in 100kHz tested by tuneSPIClock()
+static const uint8_t spi_clock_steps[] = { 5, 10, 15, 20, 25, 30, 40, 50, 60, 80, 100, 120, 160, 200, 250 };
+
+#ifdef ESP_PLATFORM
+// calibration file: magic then Calibation, files without magic are written before the spi clock was stored (spi_clock is padding there)
+static const uint16_t calibration_magic = 0xec01;
+#endif
+
 bool TFT_eTouchBase::readCalibration(const char* descr)
 {
   bool ret = false;
@@ -138,10 +266,14 @@ bool TFT_eTouchBase::readCalibration(const char* descr)
     File calfile = SPIFFS.open(descr, "r");
     if (calfile) {
       Calibation data;
-      if (calfile.readBytes((char *)&data, sizeof(data)) == sizeof(data)) {
+      uint16_t magic = 0;
+      size_t size = calfile.size();
+      if (size == sizeof(magic) + sizeof(data)) calfile.readBytes((char *)&magic, sizeof(magic));
+      if ((size == sizeof(data) || magic == calibration_magic) && calfile.readBytes((char *)&data, sizeof(data)) == sizeof(data)) {
         ret = true;
-        calibation_ = data;
-        if (Serial) Serial.printf("Calibration: %s x %u, %u, y %u, %u, r %u\n", descr, calibation_.x0, calibation_.x1, calibation_.y0, calibation_.y1, calibation_.rel_rotation);
+        if (magic != calibration_magic) data.spi_clock = 0; // old file, padding byte
+        setCalibration(data);
+        if (Serial) Serial.printf("Calibration: %s x %u, %u, y %u, %u, r %u, spi %u\n", descr, calibation_.x0, calibation_.x1, calibation_.y0, calibation_.y1, calibation_.rel_rotation, calibation_.spi_clock);
       }
       else if (Serial) Serial.println("Calibration file read error");
       calfile.close();
@@ -161,7 +293,8 @@ bool TFT_eTouchBase::writeCalibration(const char* descr)
 #ifdef ESP_PLATFORM
   File calfile = SPIFFS.open(descr, "w");
   if (calfile) {
-    ret = calfile.write((const unsigned char *)&calibation_, sizeof(calibation_)) == sizeof(calibation_);
+    ret = calfile.write((const unsigned char *)&calibration_magic, sizeof(calibration_magic)) == sizeof(calibration_magic) &&
+          calfile.write((const unsigned char *)&calibation_, sizeof(calibation_)) == sizeof(calibation_);
     calfile.close();
   }
   if (!ret && Serial) {
@@ -177,90 +310,434 @@ bool TFT_eTouchBase::writeCalibration(const char* descr)
   if (Serial) Serial.println("TFT_eTouchBase::writeCalibration() not implemented");
 #endif
   if (!ret && Serial) {
-    Serial.printf("#define TOUCH_DEFAULT_CALIBRATION { %i, %i, %i, %i, %i }\n",
-      calibation_.x0, calibation_.x1, calibation_.y0, calibation_.y1, calibation_.rel_rotation);
+    Serial.printf("#define TOUCH_DEFAULT_CALIBRATION { %i, %i, %i, %i, %i, %i }\n",
+      calibation_.x0, calibation_.x1, calibation_.y0, calibation_.y1, calibation_.rel_rotation, calibation_.spi_clock);
   }
   return ret;
 }
 
+void TFT_eTouchBase::update_transform(uint8_t rotation, int16_t width, int16_t height)
+{
+  // rotation of touch to display: 1 and 3 swap the axes, x is reversed by 2 and 3, y by 1 and 2
+  uint8_t d_rot = (4 + rotation - calibation_.rel_rotation) % 4;
+  for (uint8_t i = 0; i < 2; i++) {
+    TransformAxis& axis = transform_[i];
+    axis.from_y = (d_rot & 1) ? i == 0 : i == 1;
+    axis.max = (i == 0 ? width : height) - 1;
+    axis.r0 = axis.from_y ? calibation_.y0 : calibation_.x0;
+    int16_t d = (axis.from_y ? calibation_.y1 : calibation_.x1) - axis.r0;
+    int32_t a = d ? ((int32_t)axis.max << 16) / d : 0;
+    if (a > (1L << 18)) a = 1L << 18; // 4 pixel per raw unit, (raw - r0) * a must fit 31 bit
+    if (a < -(1L << 18)) a = -(1L << 18);
+    bool reversed = i == 0 ? d_rot >= 2 : (d_rot == 1 || d_rot == 2);
+    axis.a = reversed ? -a : a;
+    axis.b = (reversed ? (int32_t)axis.max << 16 : 0) + 0x8000;
+  }
+  transform_rotation_ = rotation;
+}
 
-void TFT_eTouchBase::update(bool only_z1)
+void TFT_eTouchBase::setSPIClock(uint32_t hz)
 {
+  spi_clock_ = hz ? hz : TOUCH_SPI_CLOCK;
+  spi_settings_ = SPISettings(spi_clock_, MSBFIRST, SPI_MODE0);
+}
+
+
+bool TFT_eTouchBase::update(bool only_z1)
+{
+#ifdef TOUCH_USE_SAMPLER
+  if (sampler_running_) { // fetched in background, take newest (the sampler owns the bus, also in async mode)
+    Sample s;
+    while (samples_.pop(s)) raw_ = s.raw;
+    return false;
+  }
+#endif // end TOUCH_USE_SAMPLER
+
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  if (async_update_ && !only_z1) {
+    if (acquire_step_ == 0 && !beginUpdate()) return false;
+    pollUpdate();
+    return true;
+  }
+#endif // end TOUCH_USE_ASYNC_UPDATE
+
 #ifdef TOUCH_USE_PENIRQ_CODE
-	if (!update_allowed_) return;
+	if (!update_allowed_) return false;
 #else
   // cant query PENIRQ for LOW, but when all measures in range then dispay is touched
 #endif // end TOUCH_USE_PENIRQ_CODE
 
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  if (fetch_pending_) { // queued fetch has priority, done when display release the bus
+    if (display_busy()) return false;
+    fetch_queued();
+    return true;
+  }
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
 	uint32_t now = micros();
-	if ( now - last_measure_time_us_ <  measure_wait_ms_*1000 ) return;
+	if ( now - last_measure_time_us_ <  measure_wait_us() ) return false;
   last_measure_time_us_ = now;
 
-  fetch_raw(only_z1);
-  
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  if (display_busy()) {
+    fetch_pending_ = only_z1 ? 1 : 2;
+    return false;
+  }
+#endif // end TOUCH_USE_DISPLAY_SYNC
+  fetch(only_z1);
+  return true;
+}
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+void TFT_eTouchBase::setDisplayBusy(DisplayBusyFnk fnk, void* ctx)
+{
+  display_busy_fnk_ = fnk;
+  display_busy_ctx_ = ctx;
+  if (!fnk) fetch_pending_ = 0;
+}
+
+bool TFT_eTouchBase::frameDone()
+{
+  if (!fetch_pending_) return false;
+  fetch_queued();
+  return true;
+}
+
+void TFT_eTouchBase::fetch_queued()
+{
+  bool only_z1 = fetch_pending_ == 1;
+  fetch_pending_ = 0;
+  last_measure_time_us_ = micros();
+  fetch(only_z1);
+}
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
+#ifdef TOUCH_USE_STATS
+static void print_us(Print& out, uint32_t ticks)
+{
+  if (TOUCH_STATS_TICKS_PER_US > 1) out.print((double)ticks / TOUCH_STATS_TICKS_PER_US, 2); // cycles, keep sub microsecond
+  else out.print(ticks);
+}
+
+static void print_histogram(Print& out, const char* name, const TouchHistogram& h)
+{
+  out.print(name);
+  out.print(h.count());
+  out.print(" p50 ");
+  print_us(out, h.percentile(50));
+  out.print(" p99 ");
+  print_us(out, h.percentile(99));
+  out.print(" max ");
+  print_us(out, h.maxTicks());
+  out.println(" us");
+}
+
+void TFT_eTouchBase::printStats(Print& out) const
+{
+  print_histogram(out, "acquire+rz ", stats_.acquire); // rz is timed inside acquire
+  print_histogram(out, "rz         ", stats_.rz);
+  print_histogram(out, "filter     ", stats_.filter);
+  print_histogram(out, "transform  ", stats_.transform);
+  out.print("conversions ");
+  out.print(stats_.conversions);
+  out.print(", out of range ");
+  out.print(stats_.out_of_range);
+  out.print(", filter drops ");
+  out.print(stats_.filter_drops);
+  out.print(", penirq wakeups ");
+  out.println(stats_.penirq_wakeups);
+}
+#endif // end TOUCH_USE_STATS
+
+void TFT_eTouchBase::fetch(bool only_z1)
+{
+#ifdef TOUCH_USE_DECIMATION
+  if (!only_z1 && decimator_.ratio() > 1) {
+    Measure raw;
+    fetch_raw(raw, false);
+    if (!decimate(raw)) return; // output period not done, raw_ keep the last measure
+    raw_ = raw;
+  }
+  else
+#endif // end TOUCH_USE_DECIMATION
+  fetch_raw(raw_, only_z1);
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  bool touched = only_z1 ? raw_.z1 > 0 : raw_.rz < rz_threshold_; // before update_done(), a filling filter set rz 0xffff
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+  update_done(raw_, only_z1);
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  adapt_wait(touched, only_z1);
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+}
+
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+void TFT_eTouchBase::setAdaptiveWait(uint16_t min_ms, uint16_t max_ms, uint16_t idle_ms, uint16_t move)
+{
+  adaptive_min_ms_ = min_ms;
+  adaptive_max_ms_ = max_ms < min_ms ? min_ms : max_ms;
+  adaptive_idle_ms_ = idle_ms;
+  adaptive_move_ = move;
+  effective_wait_ms_ = idle_ms;
+  adaptive_touched_ = false;
+}
+
+void TFT_eTouchBase::adapt_wait(bool touched, bool only_z1)
+{
+  if (!adaptive_max_ms_) return;
+  if (!touched) {
+    effective_wait_ms_ = adaptive_idle_ms_;
+    adaptive_touched_ = false;
+    return;
+  }
+  if (only_z1) { // pen down, position comes with next fetch
+    effective_wait_ms_ = adaptive_min_ms_;
+    return;
+  }
+  uint16_t dx = raw_.x > adaptive_x_ ? raw_.x - adaptive_x_ : adaptive_x_ - raw_.x;
+  uint16_t dy = raw_.y > adaptive_y_ ? raw_.y - adaptive_y_ : adaptive_y_ - raw_.y;
+  if (!adaptive_touched_ || dx > adaptive_move_ || dy > adaptive_move_) {
+    effective_wait_ms_ = adaptive_min_ms_; // pen down or move
+    adaptive_x_ = raw_.x;
+    adaptive_y_ = raw_.y;
+    adaptive_touched_ = true;
+  }
+  else { // pen stay, back off
+    uint16_t ms = effective_wait_ms_ ? effective_wait_ms_ * 2 : 1;
+    effective_wait_ms_ = ms < adaptive_max_ms_ ? ms : adaptive_max_ms_;
+  }
+}
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+
+#ifdef TOUCH_USE_DECIMATION
+void TFT_eTouchBase::setDecimation(uint16_t ratio)
+{
+  decimator_.setRatio(ratio);
+}
+
+bool TFT_eTouchBase::decimate(Measure& raw)
+{
+  if (decimator_.ratio() == 1) return true;
+  if (raw.rz == 0xffff) { // not touched, release is reported at once
+    decimator_.reset();
+    return true;
+  }
+  uint16_t value[4] = { raw.x, raw.y, raw.z1, raw.z2 };
+  if (!decimator_.add(value, value)) return false;
+  raw.x = value[0];
+  raw.y = value[1];
+  raw.z1 = value[2];
+  raw.z2 = value[3];
+  calc_rz(raw, true);
+  return true;
+}
+#endif // end TOUCH_USE_DECIMATION
+
+void TFT_eTouchBase::update_done(Measure& raw, bool only_z1)
+{
+#if !defined (TOUCH_USE_PENIRQ_CODE) && !defined (TOUCH_FILTER_TYPE)
+  (void)raw; // nothing to do
+  (void)only_z1;
+#endif
 #ifdef TOUCH_USE_PENIRQ_CODE
   if (penirq_ != 0xff) {
-    if (only_z1) update_allowed_ = raw_.z1 > 0;
-	  else update_allowed_ = valid();
+    if (only_z1) update_allowed_ = raw.z1 > 0;
+	  else update_allowed_ = raw.rz < rz_threshold_;
   }
 #endif // end TOUCH_USE_PENIRQ_CODE
 
 #ifdef TOUCH_FILTER_TYPE
-  if (!only_z1 && raw_.rz != 0xffff) {
+  if (!only_z1 && raw.rz != 0xffff) {
+# ifdef TOUCH_USE_STATS
+    TouchStatsTimer timer(stats_.filter);
+# endif
     bool empty = false;
+# if defined (TOUCH_X_FILTER) || defined (TOUCH_Y_FILTER) || defined (TOUCH_Z_FILTER)
     uint16_t val;
+# endif
 # ifdef TOUCH_X_FILTER
-    val = x_filter_->next(raw_.x);
-    if (val == 0) {
+    val = raw.x;
+    if (x_filter_.filter(val)) raw.x = val;
+    else {
       empty = true;
-#   ifdef TOUCH_SERIAL_DEBUG
+#   ifdef TOUCH_USE_LOG
+      TOUCH_LOG(log_x_filter_fill, x_filter_.filled(), x_filter_.size(), raw.x);
+#   elif defined (TOUCH_SERIAL_DEBUG)
       if (Serial) {
-        Serial.print(x_filter_->filled());
+        Serial.print(x_filter_.filled());
         Serial.print('/');
-        Serial.print(x_filter_->size());
+        Serial.print(x_filter_.size());
         Serial.print(" x filter fill ");
-        Serial.println(raw_.x);
+        Serial.println(raw.x);
       }
 #   endif
     }
-    else raw_.x = val;
 # endif
 # ifdef TOUCH_Y_FILTER
-    val = y_filter_->next(raw_.y);
-    if (val == 0) {
+    val = raw.y;
+    if (y_filter_.filter(val)) raw.y = val;
+    else {
       empty = true;
-#   ifdef TOUCH_SERIAL_DEBUG
+#   ifdef TOUCH_USE_LOG
+      TOUCH_LOG(log_y_filter_fill, y_filter_.filled(), y_filter_.size(), raw.y);
+#   elif defined (TOUCH_SERIAL_DEBUG)
       if (Serial) {
-        Serial.print(y_filter_->filled());
+        Serial.print(y_filter_.filled());
         Serial.print('/');
-        Serial.print(y_filter_->size());
+        Serial.print(y_filter_.size());
         Serial.print(" y filter fill ");
-        Serial.println(raw_.y);
+        Serial.println(raw.y);
       }
 #   endif
     }
-    else raw_.y = val;
 # endif
 # ifdef TOUCH_Z_FILTER
-    val = z1_filter_->next(raw_.z1);
-    if (val == 0) empty = true;
-    else raw_.z1 = val;
+    val = raw.z1;
+    if (z1_filter_.filter(val)) raw.z1 = val;
+    else empty = true;
 
-    val = z2_filter_->next(raw_.z2);
-    if (val == 0) empty = true;
-    else raw_.z2 = val;
+    val = raw.z2;
+    if (z2_filter_.filter(val)) raw.z2 = val;
+    else empty = true;
+# endif
+# ifdef TOUCH_FILTER_BANK
+    uint16_t lane[4] = { raw.x, raw.y, raw.z1, raw.z2 };
+    if (filter_bank_.next(lane)) {
+      raw.x = lane[0];
+      raw.y = lane[1];
+      if (filter_bank_.lanes() == 4) {
+        raw.z1 = lane[2];
+        raw.z2 = lane[3];
+      }
+    }
+    else {
+      empty = true;
+#   ifdef TOUCH_USE_LOG
+      TOUCH_LOG(log_x_filter_fill, filter_bank_.filled(), filter_bank_.size(), raw.x);
+#   elif defined (TOUCH_SERIAL_DEBUG)
+      if (Serial) {
+        Serial.print(filter_bank_.filled());
+        Serial.print('/');
+        Serial.print(filter_bank_.size());
+        Serial.print(" filter fill ");
+        Serial.println(raw.x);
+      }
+#   endif
+    }
 # endif
     if (empty) {
-      raw_.rz = 0xffff;
+      raw.rz = 0xffff;
+# ifdef TOUCH_USE_STATS
+      stats_.filter_drops++;
+# endif
     }
   }
+# if TOUCH_FILTER_WARM_START
+  else if (!only_z1) reset(); // next touch fill the filter again
+# endif
 #endif
+}
+
+#ifdef TOUCH_ADAPTIVE_FILTER
+void TFT_eTouchBase::setAdaptiveFilter(uint16_t min_cutoff, uint16_t beta, uint16_t d_cutoff)
+{
+# ifdef TOUCH_X_FILTER
+  x_filter_.setParameter(min_cutoff, beta, d_cutoff);
+# endif
+# ifdef TOUCH_Y_FILTER
+  y_filter_.setParameter(min_cutoff, beta, d_cutoff);
+# endif
+}
+#endif // end TOUCH_ADAPTIVE_FILTER
 
-#ifdef TOUCH_SERIAL_CONVERSATION_TIME
-  if (Serial) Serial.printf("TFT_eTouchBase::update() %d microseconds\n", micros() - last_measure_time_us_);
+#ifdef TOUCH_USE_SAMPLER
+#ifdef ESP32
+void TFT_eTouchBase::cb_sampler(void* arg)
+{
+  static_cast<TFT_eTouchBase*>(arg)->sample();
+}
+#endif
+
+bool TFT_eTouchBase::startSampler(uint32_t period_us)
+{
+  stopSampler();
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  acquire_step_ = 0; // drop a partial async fetch, every step is a whole spi transaction
+#endif // end TOUCH_USE_ASYNC_UPDATE
+#ifdef ESP32
+  esp_timer_create_args_t args;
+  memset(&args, 0, sizeof(args));
+  args.callback = cb_sampler;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK; // not in isr, spi transfer is allowed
+  args.name = "TFT_eTouch";
+  if (esp_timer_create(&args, &sampler_timer_) == ESP_OK) {
+    sampler_running_ = true; // before the first callback
+    if (esp_timer_start_periodic(sampler_timer_, period_us) == ESP_OK) {
+      return true;
+    }
+    sampler_running_ = false;
+    esp_timer_delete(sampler_timer_);
+    sampler_timer_ = 0;
+  }
+  if (Serial) Serial.println("TFT_eTouchBase::startSampler() could not start timer");
+  return false;
+#else
+  (void)period_us; // sample() is called by a user timer
+  sampler_running_ = true;
+  return true;
 #endif
 }
 
+void TFT_eTouchBase::stopSampler()
+{
+#ifdef ESP32
+  if (sampler_timer_) {
+    esp_timer_stop(sampler_timer_);
+    esp_timer_delete(sampler_timer_);
+    sampler_timer_ = 0;
+  }
+#endif
+  sampler_running_ = false;
+}
+
+void TFT_eTouchBase::sample()
+{
+  if (!sampler_running_) return; // not started or stopped, a user timer may still call
+  Sample s;
+  s.us = micros();
+#ifdef TOUCH_USE_PENIRQ_CODE
+  if (update_allowed_) {
+    fetch_raw(sampler_raw_, false);
+# ifdef TOUCH_USE_DECIMATION
+    if (!decimate(sampler_raw_)) return; // output period not done
+# endif
+    update_done(sampler_raw_, false);
+  }
+  else {
+    sampler_raw_.z1 = 0;
+    sampler_raw_.rz = 0xffff;
+# ifdef TOUCH_USE_DECIMATION
+    decimator_.reset();
+# endif
+  }
+#else
+  fetch_raw(sampler_raw_, false);
+# ifdef TOUCH_USE_DECIMATION
+  if (!decimate(sampler_raw_)) return; // output period not done
+# endif
+  update_done(sampler_raw_, false);
+#endif // end TOUCH_USE_PENIRQ_CODE
+  s.raw = sampler_raw_;
+  if (!samples_.push(s)) sampler_overruns_++;
+}
+
+bool TFT_eTouchBase::readSample(Sample& s)
+{
+  return samples_.pop(s);
+}
+#endif // end TOUCH_USE_SAMPLER
+
 
 // Differential Measure (SER/DFR low)
 #define X_MEASURE_DFR   0b11010001 // 0b11010011 also works
@@ -270,6 +747,9 @@ void TFT_eTouchBase::update(bool only_z1)
 
 #define OFF_MEASURE     0b10010000
 
+// MODE bit, 8 bit conversion instead of 12 bit
+#define MODE_8BIT       0b00001000
+
 // Single Ended Measure (SER/DFR high)
 #define X_MEASURE_SER   0b11010100
 #define Y_MEASURE_SER   0b10010100
@@ -288,103 +768,106 @@ void TFT_eTouchBase::update(bool only_z1)
 #define Z2_MEASURE  Z2_MEASURE_SER
 #endif
 
-void TFT_eTouchBase::fetch_raw(bool only_z1)
+void TFT_eTouchBase::setCoarseTracking(bool coarse)
+{
+  conversion_mode_ = coarse ? MODE_8BIT : 0;
+}
+
+void TFT_eTouchBase::fetch_z1(Measure& raw)
+{
+  uint8_t drop_cnt = drop_first_measures_;
+  spi_start();
+  spi_transfer(Z1_MEASURE | MODE_8BIT);
+  while (drop_cnt-- > 0) spi_transfer16(Z1_MEASURE | MODE_8BIT);
+  uint16_t data = spi_transfer16(OFF_MEASURE); // set power down mode
+  spi_end();
+  data = (data >> 7) & 0xff;
+  data = (data << 4) | (data >> 4); // rescale to 12 bit
+  raw.z1 = in_range(data) ? data : 0;
+}
+
+#ifdef TOUCH_MEASURE_POLICY
+template <class S>
+void TFT_eTouchBase::fetch_measure(Measure& raw, const S& s)
 {
   bool has_touch = true;
   uint16_t data1, data2;
   uint8_t ctrl = X_MEASURE; // X-POSITION Measure
-  uint8_t drop_cnt = drop_first_measures_;
-  
-  if (z_first_measure_ && !z_once_measure_) {
+  uint8_t drop_cnt = s.drop();
+
+  if (s.z_first() && !s.z_once()) {
     ctrl = Z1_MEASURE; // Z1-POSITION Measure
   }
   spi_start();
   
-  if (z_once_measure_) {
-    z_first_measure_ = true; // then we do it first
-    spi_.transfer(Z1_MEASURE); // Z1 Measure
+  if (s.z_once()) {
+    spi_transfer(Z1_MEASURE | conversion_mode_); // Z1 Measure
     while (has_touch && drop_cnt-- > 0) {
-      data2 = (spi_.transfer16(Z1_MEASURE) >> 3) & 0x0fff;
+      data2 = read_measure(Z1_MEASURE);
       if (!in_range(data2)) {
         has_touch = false;
-        raw_.z1 = 0;
+        raw.z1 = 0;
       }
     }
-    drop_cnt = drop_first_measures_;
+    drop_cnt = s.drop();
     if (has_touch) {
-      if (z_local_min_measure_) { // read z1 until grows
+      if (s.z_local_min()) { // read z1 until grows
         data2 = 0;
         do {
           data1 = data2;
-          data2 = (spi_.transfer16(Z1_MEASURE) >> 3) & 0x0fff;
+          data2 = read_measure(Z1_MEASURE);
         } while (data1 < data2);
       }
-      if (only_z1) raw_.z1 = (spi_.transfer16(OFF_MEASURE) >> 3) & 0x0fff;
-      else         raw_.z1 = (spi_.transfer16(Z2_MEASURE) >> 3) & 0x0fff; // Z2 Measure
-      if (!in_range(raw_.z1)) {
+      raw.z1 = read_measure(Z2_MEASURE); // Z2 Measure
+      if (!in_range(raw.z1)) {
         has_touch = false;
-        raw_.z1 = 0;
+        raw.z1 = 0;
       }
       else {
-        if (only_z1) {
-          spi_end();
-          return;
-        }
-        while (drop_cnt-- > 0) spi_.transfer16(Z2_MEASURE);
-        drop_cnt = drop_first_measures_;
-        raw_.z2 = (spi_.transfer16(ctrl) >> 3) & 0x0fff; // X Measure
-        if (!in_range(raw_.z2)) {
+        while (drop_cnt-- > 0) spi_transfer16(Z2_MEASURE | conversion_mode_);
+        drop_cnt = s.drop();
+        raw.z2 = read_measure(ctrl); // X Measure
+        if (!in_range(raw.z2)) {
           has_touch = false;
         }
       }
     }
   }
   else {
-    if (only_z1) ctrl = Z1_MEASURE;
-    spi_.transfer(ctrl); // X or Z1 Measure
-    raw_.z1 = 0;
+    spi_transfer(ctrl | conversion_mode_); // X or Z1 Measure
+    raw.z1 = 0;
   }
   
-#ifdef TOUCH_USE_AVERAGING_CODE
-  if (!averaging_measure_) {
-    ignore_min_max_measure_ = false;
-  }
-#endif // end TOUCH_USE_AVERAGING_CODE
-
   while (has_touch) {
-    if (count_measure_ == 0) {
+    if (s.count() == 0) {
       // Figure 10
       data1 = 0xffff;
       do {
         data2 = data1;
-        data1 = (spi_.transfer16(ctrl) >> 3) & 0x0fff; // X, Y, Z1 or Z2 Measure
+        data1 = read_measure(ctrl); // X, Y, Z1 or Z2 Measure
       } while (in_range(data1) && data1 != data2);  // wait until stable
     }
     else {
       // Figure 11 or averaging
 #ifdef TOUCH_USE_AVERAGING_CODE
       uint16_t min = 0xffff, max = 0;
-      data2 = count_measure_;
-      if (averaging_measure_) {
+      uint32_t sum = 0; // 12 bit values, 16 bit would overflow after 16 measures
+      data2 = s.count();
+      if (s.averaging()) {
         while (has_touch && drop_cnt-- > 0) {
-          data1 = (spi_.transfer16(ctrl) >> 3) & 0x0fff;
+          data1 = read_measure(ctrl);
           if (!in_range(data1)) {
             has_touch = false;
           }
         }
-        drop_cnt = drop_first_measures_;
+        drop_cnt = s.drop();
         if (!has_touch) break;
-        if (ignore_min_max_measure_) {
+        if (s.ignore_min_max()) {
           data2 += 2;
         }
-        if (data2 > 16) { // 16 is max! (data1 is 16bit one sum value 12bit, 4bit's for 16 Values)
-          data2 = 16;
-          if (ignore_min_max_measure_) count_measure_ = 14;
-          else                         count_measure_ = 16;
-        }
       }
 #else
-      data2 = count_measure_;
+      data2 = s.count();
 #endif // end TOUCH_USE_AVERAGING_CODE
       data1 = 0;
       uint8_t next_ctrl = ctrl;
@@ -394,32 +877,31 @@ void TFT_eTouchBase::fetch_raw(bool only_z1)
             next_ctrl = Y_MEASURE; // Y-POSITION Measure
           }
           else if (ctrl == Y_MEASURE) {
-            if (z_first_measure_) next_ctrl = OFF_MEASURE;
+            if (s.z_first()) next_ctrl = OFF_MEASURE;
             else next_ctrl = Z1_MEASURE; // Z1-POSITION Measure
           }
           else if (ctrl == Z1_MEASURE) {
-            if (!z_local_min_measure_) { // then later
+            if (!s.z_local_min()) { // then later
               next_ctrl = Z2_MEASURE; // Z2-POSITION Measure
             }
-            else if (only_z1) ctrl = OFF_MEASURE;
           }
           else if (ctrl == Z2_MEASURE) { // Z2 Measure done
-            if (!z_first_measure_) next_ctrl = OFF_MEASURE;
+            if (!s.z_first()) next_ctrl = OFF_MEASURE;
             else next_ctrl = X_MEASURE; // X-POSITION Measure
           }
 #ifdef TOUCH_USE_AVERAGING_CODE
-          if (!averaging_measure_) {
-            data1 = (spi_.transfer16(next_ctrl) >> 3) & 0x0fff; // take n'th measure of X, Y, Z1 or Z2
+          if (!s.averaging()) {
+            data1 = read_measure(next_ctrl); // take n'th measure of X, Y, Z1 or Z2
           }
 #else
-          data1 = (spi_.transfer16(next_ctrl) >> 3) & 0x0fff; // take n'th measure of X, Y, Z1 or Z2
+          data1 = read_measure(next_ctrl); // take n'th measure of X, Y, Z1 or Z2
 #endif // end TOUCH_USE_AVERAGING_CODE
         }
 #ifdef TOUCH_USE_AVERAGING_CODE
-        if (averaging_measure_) {
-          uint16_t data = (spi_.transfer16(next_ctrl) >> 3) & 0x0fff; // X, Y, Z1 or Z2 Measure
-          data1 += data;
-          if (ignore_min_max_measure_) {
+        if (s.averaging()) {
+          uint16_t data = read_measure(next_ctrl); // X, Y, Z1 or Z2 Measure
+          sum += data;
+          if (s.ignore_min_max()) {
             if (min > data) min = data;
             if (max < data) max = data;
           }
@@ -428,7 +910,7 @@ void TFT_eTouchBase::fetch_raw(bool only_z1)
           // dummy read when not n'th measure
           if (data2 > 0) {
 //            spi_.transfer16(next_ctrl);
-            data1 = (spi_.transfer16(next_ctrl) >> 3) & 0x0fff;
+            data1 = read_measure(next_ctrl);
             if (!in_range(data1)) {
               data2 = 0;
 //              has_touch = false;
@@ -439,7 +921,7 @@ void TFT_eTouchBase::fetch_raw(bool only_z1)
         else {
           // dummy read when not n'th measure
 //          spi_.transfer16(next_ctrl);
-          data1 = (spi_.transfer16(next_ctrl) >> 3) & 0x0fff;
+          data1 = read_measure(next_ctrl);
           if (!in_range(data1)) {
             data2 = 0;
           }
@@ -447,11 +929,11 @@ void TFT_eTouchBase::fetch_raw(bool only_z1)
 #endif // end TOUCH_USE_AVERAGING_CODE
       }
 #ifdef TOUCH_USE_AVERAGING_CODE
-      if (averaging_measure_) {
-        if (ignore_min_max_measure_) {
-          data1 -= (min + max);
+      if (s.averaging()) {
+        if (s.ignore_min_max()) {
+          sum -= (min + max);
         }
-        data1 /= count_measure_;
+        data1 = sum / s.count();
       }
 #endif // end TOUCH_USE_AVERAGING_CODE
     }
@@ -460,70 +942,585 @@ void TFT_eTouchBase::fetch_raw(bool only_z1)
       has_touch = false;
     }
     else if (ctrl == X_MEASURE) { // X Measure done
-      raw_.x = data1;
+      raw.x = data1;
       ctrl = Y_MEASURE; // Y-POSITION Measure
     }
     else if (ctrl == Y_MEASURE) { // Y Measure done
-      raw_.y = data1;
-      if (z_first_measure_) break;
+      raw.y = data1;
+      if (s.z_first()) break;
       ctrl = Z1_MEASURE; // Z1-POSITION Measure
     }
     else if (ctrl == Z1_MEASURE) { // Z1 Measure done
-      if (z_local_min_measure_) { // read z1 until grows
-        if (raw_.z1 >= data1) {
+      if (s.z_local_min()) { // read z1 until grows
+        if (raw.z1 >= data1) {
           ctrl = Z2_MEASURE; // Z2-POSITION Measure
-          if (count_measure_ > 0) {
-            if (!only_z1) spi_.transfer16(ctrl); // dummy read of last z1, because next transfer16() must return z2
+          if (s.count() > 0) {
+            spi_transfer16(ctrl | conversion_mode_); // dummy read of last z1, because next transfer16() must return z2
           }
         }
       }
       else {
         ctrl = Z2_MEASURE; // Z2-POSITION Measure
       }
-      raw_.z1 = data1;
-      if (only_z1 && ctrl == Z2_MEASURE) {
-        if (count_measure_ == 0) {
-          spi_.transfer16(OFF_MEASURE); // set power down mode
-        }
-        spi_end();
-        return;
-      }
+      raw.z1 = data1;
     }
     else if (ctrl == Z2_MEASURE) { // Z2 Measure done
-      raw_.z2 = data1;
-      if (!z_first_measure_) break;
+      raw.z2 = data1;
+      if (!s.z_first()) break;
       ctrl = X_MEASURE; // X-POSITION Measure
     }
   }
-  if (count_measure_ == 0 || !has_touch) {
-    spi_.transfer16(OFF_MEASURE); // set power down mode
+  if (s.count() == 0 || !has_touch) {
+    spi_transfer16(OFF_MEASURE); // set power down mode
   }
   spi_end();
 
 #ifdef TOUCH_SERIAL_DEBUG_FETCH //
   if (!has_touch) {
+# ifdef TOUCH_USE_LOG
+    TOUCH_LOG(log_out_of_range, data1, ctrl);
+# else
     if (Serial) {
       Serial.print("raw measure out of range value: ");
       Serial.print(data1);
       Serial.print(" ctrl: 0x");
       Serial.println(ctrl, BIN);
     }
+# endif
   }
 #endif
-  if (has_touch && raw_.z1 > 0) { // if z1 is 0 we get a division by 0 exception!
-    if (raw_.z1 >= raw_.z2) raw_.rz = 0;  // more then 2 Finger
-//    else raw_.rz = (uint16_t)((((int32_t)rx_plate_ * raw_.z2 / raw_.z1) * raw_.x / 4096) - (int32_t)rx_plate_ * raw_.x / 4096);
-    else raw_.rz = (uint16_t)(((((int32_t)rx_plate_ * raw_.z2 / raw_.z1) * raw_.x) - (int32_t)rx_plate_ * raw_.x) / 4096);
+  calc_rz(raw, has_touch);
+}
+#endif // end TOUCH_MEASURE_POLICY
+
+void TFT_eTouchBase::fetch_raw(Measure& raw, bool only_z1)
+{
+#ifdef TOUCH_USE_STATS
+  TouchStatsTimer timer(stats_.acquire);
+#endif // end TOUCH_USE_STATS
+  if (only_z1) { // presence check, 8 bit is enough
+    fetch_z1(raw);
+    return;
+  }
+#ifdef TOUCH_USE_BATCH_TRANSFER
+  if (fetch_raw_batch(raw)) return;
+#endif // end TOUCH_USE_BATCH_TRANSFER
+
+#ifdef TOUCH_MEASURE_POLICY
+  fetch_measure(raw, TOUCH_MEASURE_POLICY());
+#else
+  if (z_once_measure_) {
+    z_first_measure_ = true; // then we do it first
+  }
+# ifdef TOUCH_USE_AVERAGING_CODE
+  if (!averaging_measure_) {
+    ignore_min_max_measure_ = false;
+  }
+  else if (ignore_min_max_measure_ && count_measure_ > 253) { // program_ is compiled with this count
+    count_measure_ = 253;
+  }
+# endif // end TOUCH_USE_AVERAGING_CODE
+  fetch_program(raw);
+#endif // end TOUCH_MEASURE_POLICY
+}
+
+#ifndef TOUCH_MEASURE_POLICY
+// measure program step operations
+#define STEP_CHECK      0 // count conversions of ctrl, stop when not in range
+#define STEP_GROW       1 // convert ctrl until value stop growing
+#define STEP_SKIP       2 // count conversions of ctrl
+#define STEP_READ       3 // one conversion, next is started, stop when not in range
+#define STEP_STABLE     4 // convert ctrl until value is same as value before (Figure 10)
+#define STEP_NTH        5 // take count'th conversion (Figure 11)
+#define STEP_AVERAGE    6 // drop, then average count conversions
+#define STEP_OFF        7 // set power down mode
+#define STEP_OP         0x0f
+// measure program step target
+#define STEP_X          0x00
+#define STEP_Y          0x10
+#define STEP_Z1         0x20
+#define STEP_Z2         0x30
+#define STEP_TARGET(op) (((op) >> 4) & 3)
+// measure program step flags
+#define STEP_MIN_MAX    0x40 // ignore min and max conversion on averaging
+#define STEP_LOCAL_MIN  0x80 // repeat step until z1 stop growing
+
+void TFT_eTouchBase::compile_program()
+{
+  uint8_t count = count_measure_;
+#ifdef TOUCH_USE_AVERAGING_CODE
+  bool ignore_min_max = averaging_measure_ && ignore_min_max_measure_;
+  if (ignore_min_max && count > 253) { // step count is 8 bit, min and max are two conversions more
+    count = 253;
+  }
+#endif // end TOUCH_USE_AVERAGING_CODE
+
+  MeasureStep* step = program_;
+  if (z_once_measure_) { // Z1 Z2 once, then X Y
+    if (drop_first_measures_ > 0) {
+      step->ctrl = Z1_MEASURE; step->next = Z1_MEASURE; step->op = STEP_CHECK; step->count = drop_first_measures_; step++;
+    }
+    if (z_local_min_measure_) {
+      step->ctrl = Z1_MEASURE; step->next = Z1_MEASURE; step->op = STEP_GROW; step++;
+    }
+    step->ctrl = Z1_MEASURE; step->next = Z2_MEASURE; step->op = STEP_READ | STEP_Z1; step++;
+    if (drop_first_measures_ > 0) {
+      step->ctrl = Z2_MEASURE; step->next = Z2_MEASURE; step->op = STEP_SKIP; step->count = drop_first_measures_; step++;
+    }
+    step->ctrl = Z2_MEASURE; step->next = X_MEASURE; step->op = STEP_READ | STEP_Z2; step++;
+  }
+
+  static const uint8_t z_first_order[4] = { Z1_MEASURE, Z2_MEASURE, X_MEASURE, Y_MEASURE };
+  static const uint8_t z_first_target[4] = { STEP_Z1, STEP_Z2, STEP_X, STEP_Y };
+  static const uint8_t x_first_order[4] = { X_MEASURE, Y_MEASURE, Z1_MEASURE, Z2_MEASURE };
+  static const uint8_t x_first_target[4] = { STEP_X, STEP_Y, STEP_Z1, STEP_Z2 };
+  bool z_first = z_first_measure_ && !z_once_measure_; // z_once does Z1 Z2 first
+  const uint8_t* order = z_first ? z_first_order : x_first_order;
+  const uint8_t* target = z_first ? z_first_target : x_first_target;
+  uint8_t axes = z_once_measure_ ? 2 : 4; // X Y or all
+  for (uint8_t a = 0; a < axes; a++) {
+    step->ctrl = order[a];
+    step->next = a + 1 < axes ? order[a + 1] : OFF_MEASURE; // last conversion of axis start next axis
+    step->op = target[a];
+    step->count = count;
+    step->drop = 0;
+    if (target[a] == STEP_Z1 && z_local_min_measure_) {
+      step->next = Z1_MEASURE;
+      step->op |= STEP_LOCAL_MIN;
+    }
+    if (count == 0) {
+      step->op |= STEP_STABLE;
+    }
+#ifdef TOUCH_USE_AVERAGING_CODE
+    else if (averaging_measure_) {
+      step->op |= STEP_AVERAGE;
+      step->drop = drop_first_measures_;
+      if (ignore_min_max) {
+        step->op |= STEP_MIN_MAX;
+        step->count += 2;
+      }
+    }
+#endif // end TOUCH_USE_AVERAGING_CODE
+    else {
+      step->op |= STEP_NTH;
+    }
+    step++;
+  }
+  if (count == 0) {
+    step->ctrl = OFF_MEASURE; step->next = OFF_MEASURE; step->op = STEP_OFF; step++;
+  }
+  program_len_ = step - program_;
+}
+
+void TFT_eTouchBase::fetch_program(Measure& raw)
+{
+  bool has_touch = true;
+  uint16_t data = 0, last;
+  uint16_t* target[4] = { &raw.x, &raw.y, &raw.z1, &raw.z2 };
+  const MeasureStep* step = program_;
+  const MeasureStep* end = program_ + program_len_;
+
+  spi_start();
+  spi_transfer(step->ctrl | conversion_mode_);
+  raw.z1 = 0;
+  while (step < end) {
+    uint8_t n = step->count;
+    switch (step->op & STEP_OP) {
+    case STEP_CHECK:
+      while (has_touch && n-- > 0) has_touch = in_range(read_measure(step->ctrl));
+      break;
+    case STEP_GROW:
+      data = 0;
+      do {
+        last = data;
+        data = read_measure(step->ctrl);
+      } while (last < data);
+      break;
+    case STEP_SKIP:
+      while (n-- > 0) spi_transfer16(step->ctrl | conversion_mode_);
+      break;
+    case STEP_READ:
+      data = read_measure(step->next);
+      *target[STEP_TARGET(step->op)] = data;
+      has_touch = in_range(data);
+      if (!has_touch && STEP_TARGET(step->op) == STEP_TARGET(STEP_Z1)) raw.z1 = 0;
+      break;
+    case STEP_STABLE:
+      data = 0xffff;
+      do {
+        last = data;
+        data = read_measure(step->ctrl);
+      } while (in_range(data) && data != last);  // wait until stable
+      has_touch = in_range(data);
+      break;
+    case STEP_NTH:
+      while (--n > 0) { // dummy read when not n'th measure
+        data = read_measure(step->ctrl);
+        if (!in_range(data)) break;
+      }
+      if (n == 0) data = read_measure(step->next); // take n'th measure
+      has_touch = in_range(data);
+      break;
+#ifdef TOUCH_USE_AVERAGING_CODE
+    case STEP_AVERAGE: {
+      uint8_t drop_cnt = step->drop;
+      while (has_touch && drop_cnt-- > 0) has_touch = in_range(read_measure(step->ctrl));
+      if (!has_touch) break;
+      uint16_t min = 0xffff, max = 0;
+      uint32_t sum = 0; // 12 bit values, 16 bit would overflow after 16 conversions
+      while (n-- > 0) {
+        uint16_t value = read_measure(n == 0 ? step->next : step->ctrl);
+        sum += value;
+        if (min > value) min = value;
+        if (max < value) max = value;
+      }
+      if (step->op & STEP_MIN_MAX) data = (sum - min - max) / (step->count - 2);
+      else data = sum / step->count;
+      has_touch = in_range(data);
+      break;
+    }
+#endif // end TOUCH_USE_AVERAGING_CODE
+    case STEP_OFF:
+      spi_transfer16(OFF_MEASURE); // set power down mode
+      break;
+    }
+    if (!has_touch) break;
+
+    if (step->op & STEP_LOCAL_MIN) { // read z1 until grows
+      bool grows = raw.z1 < data;
+      raw.z1 = data;
+      if (grows) continue; // repeat step
+      if ((step->op & STEP_OP) != STEP_STABLE) {
+        spi_transfer16(Z2_MEASURE | conversion_mode_); // dummy read of last z1, because next transfer16() must return z2
+      }
+    }
+    else if ((step->op & STEP_OP) >= STEP_STABLE && (step->op & STEP_OP) <= STEP_AVERAGE) {
+      *target[STEP_TARGET(step->op)] = data;
+    }
+    step++;
+  }
+  if (!has_touch) {
+    spi_transfer16(OFF_MEASURE); // set power down mode
+  }
+  spi_end();
+
+#ifdef TOUCH_SERIAL_DEBUG_FETCH //
+  if (!has_touch) {
+# ifdef TOUCH_USE_LOG
+    TOUCH_LOG(log_out_of_range, data, step->ctrl);
+# else
+    if (Serial) {
+      Serial.print("raw measure out of range value: ");
+      Serial.print(data);
+      Serial.print(" ctrl: 0x");
+      Serial.println(step->ctrl, BIN);
+    }
+# endif
+  }
+#endif
+  calc_rz(raw, has_touch);
+}
+#endif // end TOUCH_MEASURE_POLICY
+
+void TFT_eTouchBase::calc_rz(Measure& raw, bool has_touch)
+{
+#ifdef TOUCH_USE_STATS
+  TouchStatsTimer timer(stats_.rz);
+#endif // end TOUCH_USE_STATS
+  if (has_touch && raw.z1 > 0) { // if z1 is 0 we get a division by 0 exception!
+    if (raw.z1 >= raw.z2) raw.rz = 0;  // more then 2 Finger
+//    else raw.rz = (uint16_t)((((int32_t)rx_plate_ * raw.z2 / raw.z1) * raw.x / 4096) - (int32_t)rx_plate_ * raw.x / 4096);
+    else raw.rz = (uint16_t)(((((int32_t)rx_plate_ * raw.z2 / raw.z1) * raw.x) - (int32_t)rx_plate_ * raw.x) / 4096);
     // Formula from ADS7846 pdf: R_TOUCH = Rx-plate * X-Position/4096 * (Z2/Z1 - 1) ; bud work only with float bud i prefer speed
-//    else raw_.rz = (uint16_t)((float)rx_plate_ * raw_.x / 4096.0 * ((float)raw_.z2 / raw_.z1 - 1.0));
+//    else raw.rz = (uint16_t)((float)rx_plate_ * raw.x / 4096.0 * ((float)raw.z2 / raw.z1 - 1.0));
 
-//    Serial.print("rz: "); Serial.print((uint16_t)((((int32_t)rx_plate_ * raw_.z2 / raw_.z1) * raw_.x / 4096) - (int32_t)rx_plate_ * raw_.x / 4096));
-//    Serial.print(", "); Serial.print((uint16_t)(((((int32_t)rx_plate_ * raw_.z2 / raw_.z1) * raw_.x) - (int32_t)rx_plate_ * raw_.x) / 4096));
-//    Serial.print(", "); Serial.print((uint16_t)((float)rx_plate_ * raw_.x / 4096.0 * ((float)raw_.z2 / raw_.z1 - 1.0))); Serial.print(" ");
+//    Serial.print("rz: "); Serial.print((uint16_t)((((int32_t)rx_plate_ * raw.z2 / raw.z1) * raw.x / 4096) - (int32_t)rx_plate_ * raw.x / 4096));
+//    Serial.print(", "); Serial.print((uint16_t)(((((int32_t)rx_plate_ * raw.z2 / raw.z1) * raw.x) - (int32_t)rx_plate_ * raw.x) / 4096));
+//    Serial.print(", "); Serial.print((uint16_t)((float)rx_plate_ * raw.x / 4096.0 * ((float)raw.z2 / raw.z1 - 1.0))); Serial.print(" ");
   }
-  else raw_.rz = 0xffff;  // indicate 'no touch'
+  else raw.rz = 0xffff;  // indicate 'no touch'
 }
 
+#ifdef TOUCH_USE_BATCH_TRANSFER
+bool TFT_eTouchBase::fetch_raw_batch(Measure& raw)
+{
+  if (count_measure_ == 0 || z_local_min_measure_) return false; // number of conversions not known in advance
+
+  struct Axis {
+    uint16_t* value; // raw member to set
+    uint8_t   ctrl;  // ctrl byte of conversion
+    uint8_t   drop;  // conversions to ignore
+    uint16_t  count; // conversions to use
+  } axis[4];
+
+  uint16_t count = count_measure_;
+  uint8_t drop = 0;
+#ifdef TOUCH_USE_AVERAGING_CODE
+  if (!averaging_measure_) {
+    ignore_min_max_measure_ = false;
+  }
+  else {
+    drop = drop_first_measures_;
+    if (ignore_min_max_measure_) {
+      count += 2;
+    }
+  }
+#endif // end TOUCH_USE_AVERAGING_CODE
+
+  uint8_t z = 2, xy = 0; // first index of z and x axis
+  if (z_once_measure_) {
+    z_first_measure_ = true; // then we do it first
+    axis[0].value = &raw.z1; axis[0].ctrl = Z1_MEASURE; axis[0].drop = drop_first_measures_; axis[0].count = 1;
+    axis[1].value = &raw.z2; axis[1].ctrl = Z2_MEASURE; axis[1].drop = drop_first_measures_; axis[1].count = 1;
+    z = 0; xy = 2;
+  }
+  else {
+    if (z_first_measure_) {
+      z = 0; xy = 2;
+    }
+    axis[z].value = &raw.z1; axis[z].ctrl = Z1_MEASURE; axis[z].drop = drop; axis[z].count = count;
+    axis[z+1].value = &raw.z2; axis[z+1].ctrl = Z2_MEASURE; axis[z+1].drop = drop; axis[z+1].count = count;
+  }
+  axis[xy].value = &raw.x; axis[xy].ctrl = X_MEASURE; axis[xy].drop = drop; axis[xy].count = count;
+  axis[xy+1].value = &raw.y; axis[xy+1].ctrl = Y_MEASURE; axis[xy+1].drop = drop; axis[xy+1].count = count;
+
+  uint16_t conversions = 0;
+  for (uint8_t a = 0; a < 4; a++) {
+    conversions += axis[a].drop + axis[a].count;
+  }
+  if (conversions > TOUCH_BATCH_MAX_CONVERSIONS) return false;
+
+  // every conversion is read with 16 clocks, the second byte is the ctrl of the next conversion (16 clocks per conversion)
+  uint8_t buf[1 + 2 * TOUCH_BATCH_MAX_CONVERSIONS];
+  uint16_t len = 0;
+  for (uint8_t a = 0; a < 4; a++) {
+    for (uint16_t i = axis[a].drop + axis[a].count; i > 0; i--) {
+      buf[len++] = axis[a].ctrl | conversion_mode_;
+      buf[len++] = 0;
+    }
+  }
+  buf[len++] = OFF_MEASURE; // set power down mode with last read
+
+  // first axis get its own transfer, when not touched we stop early
+  uint16_t first_len = 1 + 2 * (axis[0].drop + axis[0].count);
+  bool has_touch = true;
+  bool all_sent = false; // second transfer done, it ends with power down
+  const uint8_t* word = buf + 1;
+  uint16_t data = 0;
+
+  spi_start();
+  spi_transfer(buf, first_len);
+  for (uint8_t a = 0; has_touch && a < 4; a++) {
+    if (a == 1) {
+      spi_transfer(buf + first_len, len - first_len);
+      all_sent = true;
+    }
+    for (uint8_t i = axis[a].drop; has_touch && i > 0; i--, word += 2) {
+      data = decode_measure(word[0] << 8 | word[1]);
+      if (!in_range(data)) has_touch = false;
+    }
+    if (!has_touch) break;
+#ifdef TOUCH_USE_AVERAGING_CODE
+    if (averaging_measure_ && axis[a].count > 1) {
+      uint16_t min = 0xffff, max = 0;
+      uint32_t sum = 0;
+      for (uint16_t i = axis[a].count; i > 0; i--, word += 2) {
+        data = decode_measure(word[0] << 8 | word[1]);
+        sum += data;
+        if (min > data) min = data;
+        if (max < data) max = data;
+      }
+      if (ignore_min_max_measure_) {
+        sum -= (min + max);
+      }
+      data = sum / count_measure_;
+    }
+    else
+#endif // end TOUCH_USE_AVERAGING_CODE
+    {
+      // take n'th measure, all must be in range
+      for (uint16_t i = axis[a].count; has_touch && i > 0; i--, word += 2) {
+        data = decode_measure(word[0] << 8 | word[1]);
+        if (!in_range(data)) has_touch = false;
+      }
+    }
+    if (!in_range(data)) has_touch = false;
+    else *axis[a].value = data;
+  }
+  if (!has_touch) {
+    raw.z1 = 0;
+  }
+  if (!all_sent) {
+    spi_transfer16(OFF_MEASURE); // set power down mode, first transfer ends with ctrl of next axis
+  }
+  spi_end();
+
+#ifdef TOUCH_SERIAL_DEBUG_FETCH
+  if (!has_touch) {
+# ifdef TOUCH_USE_LOG
+    TOUCH_LOG(log_block_out_of_range, data);
+# else
+    if (Serial) {
+      Serial.print("raw block measure out of range value: ");
+      Serial.println(data);
+    }
+# endif
+  }
+#endif
+  calc_rz(raw, has_touch);
+  return true;
+}
+#endif // end TOUCH_USE_BATCH_TRANSFER
+
+#ifdef TOUCH_USE_ASYNC_UPDATE
+bool TFT_eTouchBase::beginUpdate()
+{
+  if (acquire_step_ != 0) return false; // fetch is running
+#ifdef TOUCH_USE_SAMPLER
+  if (sampler_running_) return false; // the sampler owns the bus
+#endif // end TOUCH_USE_SAMPLER
+
+#ifdef TOUCH_USE_PENIRQ_CODE
+  if (!update_allowed_) return false;
+#endif // end TOUCH_USE_PENIRQ_CODE
+
+  uint32_t now = micros();
+  if ( now - last_measure_time_us_ <  measure_wait_us() ) return false;
+  last_measure_time_us_ = now;
+
+  acquire_step_ = 1;
+  return true;
+}
+
+bool TFT_eTouchBase::pollUpdate()
+{
+  if (acquire_step_ == 0) return false;
+
+  // axis order of a fetch: Z1 Z2 X Y or X Y Z1 Z2
+  static const uint8_t z_first_order[4] = { Z1_MEASURE, Z2_MEASURE, X_MEASURE, Y_MEASURE };
+  static const uint8_t x_first_order[4] = { X_MEASURE, Y_MEASURE, Z1_MEASURE, Z2_MEASURE };
+  if (z_once_measure_) {
+    z_first_measure_ = true; // then we do it first
+  }
+  uint8_t ctrl = z_first_measure_ ? z_first_order[acquire_step_ - 1] : x_first_order[acquire_step_ - 1];
+  uint16_t* value = &acquire_.y;
+  if (ctrl == X_MEASURE)       value = &acquire_.x;
+  else if (ctrl == Z1_MEASURE) value = &acquire_.z1;
+  else if (ctrl == Z2_MEASURE) value = &acquire_.z2;
+
+  if (fetch_axis(ctrl, *value)) {
+    if (acquire_step_ < 4) {
+      acquire_step_++;
+      return false;
+    }
+#ifdef TOUCH_USE_DECIMATION
+    acquire_step_ = 0;
+    calc_rz(acquire_, true);
+    if (!decimate(acquire_)) return false; // output period not done
+#endif // end TOUCH_USE_DECIMATION
+    raw_.x = acquire_.x;
+    raw_.y = acquire_.y;
+    raw_.z1 = acquire_.z1;
+    raw_.z2 = acquire_.z2;
+    calc_rz(raw_, true);
+  }
+  else {
+    raw_.z1 = 0;
+    calc_rz(raw_, false);
+#ifdef TOUCH_USE_DECIMATION
+    decimator_.reset();
+#endif // end TOUCH_USE_DECIMATION
+  }
+  acquire_step_ = 0;
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  bool touched = raw_.rz < rz_threshold_; // before update_done(), a filling filter set rz 0xffff
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+  update_done(raw_, false);
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  adapt_wait(touched, false);
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+  return true;
+}
+
+bool TFT_eTouchBase::fetch_axis(uint8_t ctrl, uint16_t& value)
+{
+  bool has_touch;
+  spi_start();
+  spi_transfer(ctrl | conversion_mode_);
+  if (ctrl == Z1_MEASURE && z_local_min_measure_) { // read z1 until grows
+    uint8_t tries = 16;
+    uint16_t last;
+    value = 0;
+    do {
+      last = value;
+      has_touch = read_axis(ctrl, value);
+    } while (has_touch && last < value && --tries > 0);
+  }
+  else {
+    has_touch = read_axis(ctrl, value);
+  }
+  spi_transfer16(OFF_MEASURE); // set power down mode until next step
+  spi_end();
+  return has_touch;
+}
+
+bool TFT_eTouchBase::read_axis(uint8_t ctrl, uint16_t& value)
+{
+  uint16_t data = 0;
+  if (z_once_measure_ && (ctrl == Z1_MEASURE || ctrl == Z2_MEASURE)) {
+    for (uint8_t i = drop_first_measures_; i > 0; i--) {
+      data = read_measure(ctrl);
+      if (ctrl == Z1_MEASURE && !in_range(data)) return false;
+    }
+    data = read_measure(ctrl);
+  }
+  else if (count_measure_ == 0) {
+    // Figure 10, limited to 16 conversions
+    uint8_t tries = 16;
+    uint16_t last;
+    data = 0xffff;
+    do {
+      last = data;
+      data = read_measure(ctrl);
+    } while (in_range(data) && data != last && --tries > 0);
+  }
+#ifdef TOUCH_USE_AVERAGING_CODE
+  else if (averaging_measure_) {
+    for (uint8_t i = drop_first_measures_; i > 0; i--) {
+      data = read_measure(ctrl);
+      if (!in_range(data)) return false;
+    }
+    uint16_t count = count_measure_;
+    if (ignore_min_max_measure_) {
+      count += 2;
+    }
+    uint16_t min = 0xffff, max = 0;
+    uint32_t sum = 0;
+    while (count-- > 0) {
+      data = read_measure(ctrl);
+      sum += data;
+      if (min > data) min = data;
+      if (max < data) max = data;
+    }
+    if (ignore_min_max_measure_) {
+      sum -= (min + max);
+    }
+    data = sum / count_measure_;
+  }
+#endif // end TOUCH_USE_AVERAGING_CODE
+  else {
+    // Figure 11, take n'th measure
+    for (uint8_t i = count_measure_; i > 0; i--) {
+      data = read_measure(ctrl);
+      if (!in_range(data)) return false;
+    }
+  }
+  if (!in_range(data)) return false;
+  value = data;
+  return true;
+}
+#endif // end TOUCH_USE_ASYNC_UPDATE
+
 
 // -- 
 #ifdef TOUCH_USE_USER_CALIBRATION
@@ -554,6 +1551,16 @@ bool TFT_eTouchBase::acurateCalibrationTarget(CalibrationPoint& point)
   uint16_t sum_x = 0, sum_y = 0;
   uint16_t org_wait = getMeasureWait();
   setMeasureWait(0);
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  uint16_t org_max = adaptive_max_ms_;
+  adaptive_max_ms_ = 0;
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+  uint8_t org_mode = conversion_mode_;
+  conversion_mode_ = 0; // calibrate with 12 bit
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  bool org_async = async_update_;
+  async_update_ = false;
+#endif // end TOUCH_USE_ASYNC_UPDATE
   while (cnt < 16) {
     update(false);
     if (valid()) {
@@ -569,6 +1576,13 @@ bool TFT_eTouchBase::acurateCalibrationTarget(CalibrationPoint& point)
     }
   }
   setMeasureWait(org_wait);
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  adaptive_max_ms_ = org_max;
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+  conversion_mode_ = org_mode;
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  async_update_ = org_async;
+#endif // end TOUCH_USE_ASYNC_UPDATE
   point.touch_x = (sum_x - max_x - min_x) / 14;
   point.touch_y = (sum_y - max_y - min_y) / 14;
   
@@ -596,4 +1610,73 @@ bool TFT_eTouchBase::acurateCalibrationTarget(CalibrationPoint& point)
   return acurate;
 }
 
+
+uint32_t TFT_eTouchBase::tuneSPIClock(uint32_t max_hz, uint8_t rounds, uint32_t timeout_ms)
+{
+  uint32_t org_clock = spi_clock_;
+  uint8_t best = 0;
+  Measure ref, m;
+
+  setSPIClock(TOUCH_SPI_CLOCK / 4);
+  uint32_t start = millis();
+  do { // wait for the touch
+    if (millis() - start > timeout_ms) {
+      if (Serial) Serial.println("TFT_eTouchBase::tuneSPIClock() not touched");
+      setSPIClock(org_clock);
+      return 0;
+    }
+    delay(1);
+    fetch_raw(ref, false);
+  } while (ref.rz == 0xffff);
+  delay(100);
+
+  for (uint8_t i = 0; i < sizeof(spi_clock_steps); i++) {
+    uint32_t hz = spi_clock_steps[i] * 100000UL;
+    if (hz > max_hz) break;
+
+    // reference position with slow clock, average of 6 measures without min and max
+    setSPIClock(TOUCH_SPI_CLOCK / 4);
+    uint32_t sum_x = 0, sum_y = 0;
+    uint16_t max_x = 0, max_y = 0;
+    uint16_t min_x = 0xffff, min_y = 0xffff;
+    for (uint8_t r = 0; r < 6; r++) {
+      fetch_raw(ref, false);
+      if (ref.rz == 0xffff) {
+        if (Serial) Serial.println("TFT_eTouchBase::tuneSPIClock() pen released");
+        setSPIClock(org_clock);
+        return 0;
+      }
+      sum_x += ref.x; sum_y += ref.y;
+      if (max_x < ref.x) max_x = ref.x;
+      if (max_y < ref.y) max_y = ref.y;
+      if (min_x > ref.x) min_x = ref.x;
+      if (min_y > ref.y) min_y = ref.y;
+    }
+    ref.x = (sum_x - max_x - min_x) / 4;
+    ref.y = (sum_y - max_y - min_y) / 4;
+
+    setSPIClock(hz);
+    uint8_t errors = 0;
+    for (uint8_t r = 0; r < rounds; r++) {
+      fetch_raw(m, false);
+      int16_t dx = m.x - ref.x;
+      int16_t dy = m.y - ref.y;
+      if (dx < 0) dx = -dx;
+      if (dy < 0) dy = -dy;
+      if (m.rz == 0xffff || dx > (int16_t)acurate_difference_ || dy > (int16_t)acurate_difference_) errors++;
+    }
+    if (Serial) Serial.printf("TFT_eTouchBase::tuneSPIClock() %lu Hz %u/%u errors\n", (unsigned long)hz, errors, rounds);
+    if (errors > rounds / 8) break; // more errors than noise
+    best = spi_clock_steps[i];
+  }
+
+  if (best == 0) {
+    setSPIClock(org_clock);
+    return 0;
+  }
+  calibation_.spi_clock = best;
+  setSPIClock(best * 100000UL);
+  return spi_clock_;
+}
+
 #endif // TOUCH_USE_USER_CALIBRATION
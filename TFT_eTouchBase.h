@@ -24,15 +24,60 @@
 
 #include <TFT_eTouchUser.h>
 
+#ifdef TOUCH_USE_SAMPLER
+#include <TFT_eTouchRing.h>
+# ifdef ESP32
+#include <esp_timer.h>
+# endif
+#endif
+
+#ifdef TOUCH_MEASURE_POLICY
+#include <TFT_eTouchPolicy.h>
+#endif
+
+#ifdef TOUCH_USE_TRACE
+#include <TFT_eTouchTrace.h>
+#endif
+
+#ifdef TOUCH_USE_STATS
+#include <TFT_eTouchStats.h>
+#endif
+
+#ifdef TOUCH_USE_LOG
+#include <TFT_eTouchLog.h>
+#endif
+
+#ifdef TOUCH_USE_DECIMATION
+#include <TFT_eTouchDecimator.h>
+#endif
+
+#ifdef TOUCH_USE_TASK
+# if !defined (ESP32) && !defined (DOXYGEN)
+#error "TOUCH_USE_TASK is only available on ESP32"
+# endif
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#endif
+
 #ifdef TOUCH_USE_GESTURE
 class TFT_eTouchGesture;
 #endif
 
+#ifdef TOUCH_USE_BUS
+class TFT_eTouchBus;
+#endif
+
 /** 
   * @brief touch support base
   */
 class TFT_eTouchBase
 {
+#ifdef TOUCH_USE_BUS
+  friend class TFT_eTouchBus;
+#endif
+
 public:
 /** 
   * These are the calibration values for the touchscreen. 
@@ -42,6 +87,8 @@ public:
   * when y1 < y0 the touch y axis is in oposite direction as the tft axis.
   *
   * The calibration values { 250, 3800, 260, 3850, 2 } and { 3800, 250, 3850, 260, 0 } are identical.
+  *
+  * The optional sixth value is the spi clock in 100kHz found by tuneSPIClock(), 0 use TOUCH_SPI_CLOCK. It fills the padding, the size is unchanged; calibration files are marked with a magic so an old padding byte is not taken as clock.
   * @brief touch calibation
   */
   struct Calibation 
@@ -52,6 +99,7 @@ public:
     uint16_t y1; ///< y touch value of last display pixel
     
     uint8_t rel_rotation;  ///< relative rotation clockwise from display to touch
+    uint8_t spi_clock;  ///< spi clock in 100kHz, 0 when TOUCH_SPI_CLOCK is used
   };
 
 /** 
@@ -86,6 +134,40 @@ public:
     { x = _x; y = _y; rz = _rz; }
   };
 
+#ifdef TOUCH_USE_TASK
+/** 
+  * This struct hold one touch event posted by the touch task. 
+  * 
+  * @brief touch event
+  */
+  struct TouchEvent
+  {
+    typedef enum
+    {
+      pen_down, ///< display is touched
+      move,     ///< touch position changed
+      pen_up    ///< display is not touched anymore, tp is last position
+    } Type;
+
+    Type        type; ///< what happend
+    TouchPoint  tp; ///< display position and pressure
+    uint32_t    ms; ///< millis() of fetch
+  };
+#endif // end TOUCH_USE_TASK
+
+#ifdef TOUCH_USE_SAMPLER
+/** 
+  * This struct hold one raw touch measure with the time of the fetch. 
+  * 
+  * @brief touch sample
+  */
+  struct Sample
+  {
+    Measure     raw; ///< filtered raw measure, raw.rz is 0xffff when not touched
+    uint32_t    us;  ///< micros() at start of the fetch
+  };
+#endif // end TOUCH_USE_SAMPLER
+
 /** 
   * Create instance with defaults.
   *
@@ -97,6 +179,14 @@ public:
   */
               TFT_eTouchBase(uint8_t cs_pin, uint8_t penirq_pin = 0xff, SPIClass& spi = SPI);
 
+#ifdef TOUCH_USE_PENIRQ_CODE
+/** 
+  * Detach penirq and free the entry of the penirq dispatch table.
+  * @brief destructor
+  */
+              ~TFT_eTouchBase();
+#endif // end TOUCH_USE_PENIRQ_CODE
+
 /** 
   * Initialize the processor cs pin.
   * @brief  init cs pin
@@ -155,7 +245,7 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   inline uint16_t getRZ() const;
 
 /** 
-  * Set the calibration for this touchscreen.
+  * Set the calibration for this touchscreen. The spi clock of the calibration is used for next transfer.
   * @brief  set calibration
   * @param data touch calibration for display 
   */
@@ -168,8 +258,17 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   */
   inline Calibation& calibration();
 
+/** 
+  * The transform from raw measure to display pixels is computed once for the display rotation and calibration,
+  * per measure it needs then one multiply-add for each axis. setCalibration(), calibration() and a changed display rotation
+  * let TFT_eTouch<T>::transform() compute it again. Call this when the display size changed or a reference of calibration() is changed later.
+  * @brief  invalidate transform
+  */
+  inline void invalidateTransform();
+
 /** 
   * Read the calibration for this touchscreen from SPIFLASH or EPROM.
+  * Files of writeCalibration() start with a magic, a file without (written before the spi clock was stored) is read with spi clock 0.
   * @brief  read calibration
   * @param descr filename in flash or adr in eprom
   * @return true when data was readed, otherwise data is invalid
@@ -183,6 +282,34 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   * @return true when data was written, otherwise calibration is not stored
   */
   bool        writeCalibration(const char* descr);
+
+/** 
+  * Set the spi clock for touch transfers. The SPISettings are build once and reused by every transfer.
+  * @brief  set spi clock
+  * @param hz spi clock, 0 use TOUCH_SPI_CLOCK
+  */
+  void        setSPIClock(uint32_t hz);
+
+/** 
+  * @brief  get spi clock
+  * @return spi clock in Hz used for touch transfers
+  */
+  inline uint32_t getSPIClock() const;
+
+/** 
+  * The chip can convert with 8 bit instead of 12 bit, this is faster. The 8 bit results are rescaled to 0..4095,
+  * so Measure, valid range and RZ calculation keep working with 16 times coarser values.
+  * The z1 check of update(true) and waitPenUp() use always 8 bit.
+  * @brief  set coarse tracking
+  * @param coarse when true all measures are done with 8 bit conversion
+  */
+  void        setCoarseTracking(bool coarse);
+
+/** 
+  * @brief  get coarse tracking
+  * @return true when measures are done with 8 bit conversion
+  */
+  inline bool getCoarseTracking() const;
   
 /** 
   * Set the measure strategie.
@@ -193,7 +320,7 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   * - when not take the n'th measurement?<br>
   * This is the Figure 11 implmentation from sbaa036.pdf. Set setAveraging(false) & count = n (0<n<256) to take the n'th measurement.
   * - averaging count measurement?<br>
-  * Set averaging=true & count = n (0<n<15) to number of measurement to average.
+  * Set averaging=true & count = n (0<n<256) to number of measurement to average, the sum is 32 bit.
   * If ignore_min_max=true, do two measurement more for ignore min and max measure.
   * - start measure with X or Z1?<br>
   * When measure of X gives a value in_range() bud Z1 not (touchscreen not touched), its better to start with Z1 (z_first = true)
@@ -213,11 +340,14 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   * @param z_first when true start measure with Z1 otherwise with X
   * @param z_local_min when true, get local minimum of RZ
   * @param count how many values used by averaging or witch measure is taken. 0 means read until measure is equal last measure
+  * @note not available when TOUCH_MEASURE_POLICY is defined
   */
+#ifndef TOUCH_MEASURE_POLICY
   inline void setMeasure(uint8_t drop_first = 0, bool z_once = false, bool z_first = false, bool z_local_min = false, uint8_t count = 0);
+#endif // end TOUCH_MEASURE_POLICY
 
 
-#ifdef TOUCH_USE_AVERAGING_CODE
+#if defined (TOUCH_USE_AVERAGING_CODE) && !defined (TOUCH_MEASURE_POLICY)
 /** 
   * Set averaging mode.
   *
@@ -249,6 +379,104 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   */
   inline uint16_t getMeasureWait() const;
 
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+ /** 
+  * Enable the adaptive waiting time. Not touched the chip is invoked every idle_ms (with penirq only after the interrupt),
+  * after pen down or a move greater than move the waiting time is min_ms, while the pen stay it is doubled until max_ms is reached.
+  * When max_ms is 0 the fixed waiting time of setMeasureWait() is used.
+  * @brief set adaptive waiting time
+  * @param min_ms waiting time after pen down or move
+  * @param max_ms longest waiting time while pen stay, 0 disable adaptive waiting time
+  * @param idle_ms waiting time when not touched
+  * @param move raw distance on X or Y recognized as move
+  */
+  void        setAdaptiveWait(uint16_t min_ms, uint16_t max_ms, uint16_t idle_ms, uint16_t move = 8);
+
+ /** 
+  * @brief get effective waiting time
+  * @return actual waiting time between measures in miliseconds
+  */
+  inline uint16_t getEffectiveWait() const;
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+
+#ifdef TOUCH_USE_DECIMATION
+ /** 
+  * Fetch ratio times per measure wait and reduce them with a cascaded integrator comb decimator of order TOUCH_DECIMATION_ORDER
+  * to one measure. The noise of the position shrinks with the square root of ratio, a fetch should then be short (e.g. setMeasure(0, false, false, false, 1)).
+  * With the sampler the period of startSampler() is the input rate, only every ratio'th sample is stored.
+  * A not touched fetch reset the decimator and is reported at once, after pen down the first measure comes after TOUCH_DECIMATION_ORDER * ratio fetches.
+  * @brief set decimation
+  * @param ratio fetches per measure, rounded down to a power of two, 0 or 1 is off
+  */
+  void        setDecimation(uint16_t ratio);
+
+ /** 
+  * @brief get decimation
+  * @return fetches per measure, 1 when off
+  */
+  inline uint16_t getDecimation() const;
+#endif // end TOUCH_USE_DECIMATION
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  typedef bool (*DisplayBusyFnk)(void* ctx); ///< returns true while the display use the spi bus
+
+ /** 
+  * Set the function asked before every fetch. While it returns true the fetch is not done but queued (at most one),
+  * the queued fetch is done by the next update when the display is idle or by frameDone().
+  * Not used with setAsyncUpdate(), its steps are short enough.
+  * @brief set display busy function
+  * @param fnk busy function, 0 disable display sync
+  * @param ctx given to fnk
+  */
+  void        setDisplayBusy(DisplayBusyFnk fnk, void* ctx = 0);
+
+ /** 
+  * Call it when the display has finished a frame (not from interrupt). A queued fetch is done now.
+  * @brief display frame done
+  * @return true when a queued fetch was done
+  */
+  bool        frameDone();
+
+ /** 
+  * @brief fetch queued
+  * @return true when a fetch is waiting for the display
+  */
+  inline bool fetchPending() const;
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
+#ifdef TOUCH_USE_TRACE
+ /** 
+  * All spi transfers of the touch pass the trace. It record them or, on replay, answer instead of the chip.
+  * On replay set measure wait to 0, every fetch take the next record.
+  * @brief set trace
+  * @param trace used trace, 0 disable tracing
+  */
+  inline void setTrace(TFT_eTouchTrace* trace);
+ /** 
+  * @brief get trace
+  * @return used trace, 0 when not set
+  */
+  inline TFT_eTouchTrace* getTrace() const;
+#endif // end TOUCH_USE_TRACE
+
+#ifdef TOUCH_USE_STATS
+ /** 
+  * @brief get statistics
+  * @return durations and counters since start or resetStats()
+  */
+  inline const TouchStats& stats() const;
+ /** 
+  * @brief clear statistics
+  */
+  inline void resetStats();
+ /** 
+  * Print count, p50, p99 and max in microseconds (fractions from cpu cycles on ESP) of each stage and the counters. The acquire line includes rz.
+  * @brief print statistics
+  * @param out e.g. Serial
+  */
+  void        printStats(Print& out) const;
+#endif // end TOUCH_USE_STATS
+
  /** 
   * Set the resistace of the X-plate. The value can be between 300 and 1200. It is used for calculating RZ. If you change this value you have to change also the RZ threshold.
   * @brief set RX-plate
@@ -284,6 +512,125 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   */
   inline void reset();
 
+#ifdef TOUCH_ADAPTIVE_FILTER
+ /** 
+  * Only with TOUCH_FILTER_TYPE 4. The cutoff frequency of the x and y filter is min_cutoff + beta * speed / 256.
+  * @brief set parameter of the speed adaptive filter
+  * @param min_cutoff cutoff of a resting pen in 0.01 Hz, lower is smoother (default 100)
+  * @param beta cutoff increase in 0.01 Hz per 256 raw/s, higher is less lag when moving (default 50)
+  * @param d_cutoff cutoff of the speed in 0.01 Hz (default 100)
+  * @sa OneEuroFilter
+  */
+  void setAdaptiveFilter(uint16_t min_cutoff, uint16_t beta, uint16_t d_cutoff = 100);
+#endif // end TOUCH_ADAPTIVE_FILTER
+
+#ifdef TOUCH_USE_ASYNC_UPDATE
+ /** 
+  * Start a new fetch when none is running and the waiting time is reached. The fetch is done with pollUpdate().
+  * @brief start fetch
+  * @return true when a new fetch is started
+  */
+  bool        beginUpdate();
+
+ /** 
+  * Do the next step of a fetch started with beginUpdate(). One step measure one axis (Z1, Z2, X or Y) with the actual measure strategie,
+  * so a call takes only a part of the time of a whole fetch. The new measure is set when the last step is done
+  * or the display is not touched, until then getRZ() and getRaw() report the last measure.
+  *
+  * When the measure strategie wait until measures are stable (count = 0 or z_local_min) the conversions of one step are limited to 16.
+@code
+void loop() {
+  touch.pollUpdate(); // 1 kHz control loop, each call takes only a few microseconds
+  if (touch.getRZ() != 0xffff) {
+    // do something with last complete measure
+  }
+}
+@endcode
+  * @brief do fetch step
+  * @return true when a new measure is set
+  */
+  bool        pollUpdate();
+
+ /** 
+  * @brief is fetch running
+  * @return true when beginUpdate() started a fetch that is not finished
+  */
+  inline bool updating() const;
+
+ /** 
+  * When set, getRaw(), TFT_eTouch<T>::getXY() and TFT_eTouch<T>::get() start a fetch or do the next fetch step instead of a whole fetch.
+  * They return the last complete measure without blocking. While the sampler is running they take its samples, no fetch step is done.
+  * @brief set non-blocking update
+  * @param async true for non-blocking update
+  */
+  inline void setAsyncUpdate(bool async);
+#endif // end TOUCH_USE_ASYNC_UPDATE
+
+#ifdef TOUCH_USE_SAMPLER
+ /** 
+  * Start fetching with a fixed rate in background. Every fetch is filtered and stored with its time in a ring of TOUCH_SAMPLER_SIZE samples,
+  * read them with readSample(). As long the sampler is running getRaw(), TFT_eTouch<T>::getXY() and TFT_eTouch<T>::get() do not fetch,
+  * they take the newest sample and drop the older ones.
+  *
+  * On ESP32 a esp_timer is used, its callback is dispatched to the esp_timer task where spi transfers are allowed.
+  * On other processors no timer is started, the sampler is armed and you call sample() from your own timer with period_us.
+  * @brief start background sampling
+  * @param period_us time between two fetches in microseconds
+  * @return true when timer is started or armed for a user timer
+  */
+  bool        startSampler(uint32_t period_us);
+
+ /** 
+  * sample() does nothing afterwards, also when called by a user timer.
+  * @brief stop background sampling
+  */
+  void        stopSampler();
+
+ /** 
+  * Fetch and filter one measure and store it in the sample ring. This is the producer of the ring, call it only from one timer.
+  * Does nothing when the sampler is not started with startSampler().
+  * When TOUCH_USE_PENIRQ_CODE is used and the display is not touched, a not touched sample is stored without spi transfer.
+  * @brief fetch sample
+  */
+  void        sample();
+
+ /** 
+  * Get the oldest sample from the ring. This is the consumer of the ring, call it only from one task (e.g. loop()).
+  * Do not call reset() while the sampler is running.
+  * @brief read sample
+  * @param s oldest sample, only set when the function returns true
+  * @return true when a sample was available
+  */
+  bool        readSample(Sample& s);
+
+ /** 
+  * @brief lost samples
+  * @return number of samples dropped because the ring was full
+  */
+  inline uint16_t samplerOverruns() const;
+#endif // end TOUCH_USE_SAMPLER
+
+#ifdef TOUCH_USE_TASK
+ /** 
+  * Set the mutex guarding the spi bus. Every touch fetch take the mutex, the display driver has to take it also
+  * around its drawing when the touch task is running. TFT_eTouch<T>::startTask() create one when none is set.
+@code
+xSemaphoreTake(touch.busMutex(), portMAX_DELAY);
+tft.fillRect(0, 0, 100, 100, TFT_BLUE);
+xSemaphoreGive(touch.busMutex());
+@endcode
+  * @brief set bus mutex
+  * @param mutex mutex created with xSemaphoreCreateMutex()
+  */
+  inline void setBusMutex(SemaphoreHandle_t mutex);
+
+ /** 
+  * @brief get bus mutex
+  * @return mutex guarding the spi bus, 0 when not set
+  */
+  inline SemaphoreHandle_t busMutex() const;
+#endif // end TOUCH_USE_TASK
+
 #ifdef TOUCH_USE_USER_CALIBRATION
  /** 
   * If you stay with the pen on the touchscreen the X and Y measure will change a little bit. This value describe the
@@ -298,6 +645,19 @@ while (touch.getRaw(x, y, z1, z2, rz)) {
   */
   inline uint16_t getAcurateDistance() const;
 
+ /** 
+  * Find the fastest stable spi clock. The call waits up to timeout_ms for a touch, the pen has to stay on the touchscreen during the sweep.
+  * For every clock up to max_hz the pen position is measured at TOUCH_SPI_CLOCK / 4 as reference, then rounds fetches are done with the clock.
+  * A fetch is faulty when it is not touched or X or Y differ more than getAcurateDistance() from reference, the clock is stable when not more than 1/8 of the fetches are faulty.
+  * The sweep stops at first unstable clock, the last stable clock is used and stored in calibration(), write it with writeCalibration().
+  * @brief  tune spi clock
+  * @param max_hz fastest clock tested
+  * @param rounds fetches per clock
+  * @param timeout_ms maximal waiting time for the touch
+  * @return choosen clock in Hz, 0 when not touched within timeout_ms, pen was released or no clock was stable (clock unchanged)
+  */
+  uint32_t    tuneSPIClock(uint32_t max_hz = 8000000, uint8_t rounds = 32, uint32_t timeout_ms = 10000);
+
 protected:
 /** 
   * The user has to touch at scr_x and scr_y, the touch coordinate stored then in touch_x and touch_y.
@@ -338,33 +698,130 @@ protected:
   * After the call check (raw z1 > 0) if true, then we have a touch.
   * @brief  update raw in time
   * @param only_z1 when true fetch only z1, otherwise x, y, z1, z2 and calculate RZ
+  * @return true when the touch chip was accessed (a fetch or async step), false when nothing was to do
   */
-  void        update(bool only_z1);
+  bool        update(bool only_z1);
+
+/** 
+  * Same as update() without checking waiting time and penirq.
+  * @brief  update raw now
+  * @param only_z1 when true fetch only z1, otherwise x, y, z1, z2 and calculate RZ
+  */
+  void        fetch(bool only_z1);
+
+/** 
+  * Set penirq state and filter the measure. Call this after the raw values are fetched.
+  * @brief  finish update
+  * @param raw fetched measure
+  * @param only_z1 when true only z1 was fetched
+  */
+  void        update_done(Measure& raw, bool only_z1);
   
   inline bool valid();       ///< goes true when tuched (RZ < RZ threshold)
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  inline bool display_busy(); ///< true while the display use the spi bus
+#endif // end TOUCH_USE_DISPLAY_SYNC
+
+#ifdef TOUCH_USE_PENIRQ_CODE
+/** 
+  * Take a free entry of the penirq dispatch table and attach the interrupt. When the table is full, penirq is not used.
+  * @brief  attach penirq
+  * @return false when all TOUCH_MAX_INSTANCES entries are used
+  */
+  bool        attach_penirq();
+#endif // end TOUCH_USE_PENIRQ_CODE
 
   SPIClass&   spi_;  ///< used spi bus. display and touch must use the same bus
   uint8_t     cs_;   ///< chip select pin
   uint8_t     penirq_; ///< penirq pin
 
   Calibation  calibation_; ///< used callibration for transforming touch measure into display pixels
+
+ /** 
+  * One display coordinate from one raw value: ((raw - r0) * a + b) >> 16, clamped to 0..max.
+  * @brief transform of one axis
+  */
+  struct TransformAxis
+  {
+    int32_t   a; ///< display pixels per raw unit, Q16
+    int32_t   b; ///< display pixel at raw r0, Q16 including rounding
+    uint16_t  r0; ///< raw calibration start
+    int16_t   max; ///< largest display coordinate
+    bool      from_y; ///< take raw y, otherwise raw x
+  };
+  TransformAxis transform_[2]; ///< display x and y, valid for transform_rotation_
+  uint8_t     transform_rotation_; ///< display rotation of transform_, 0xff when not computed
+
+  void        update_transform(uint8_t rotation, int16_t width, int16_t height); ///< compute transform_ for display rotation and size
+  inline int16_t transform_axis(const TransformAxis& axis, const Measure& raw) const; ///< display coordinate of raw
+  uint32_t    spi_clock_; ///< spi clock in Hz
+  SPISettings spi_settings_; ///< used for every touch transfer
   Measure     raw_; ///< last touch measure
 
 #ifdef TOUCH_USE_GESTURE
   TFT_eTouchGesture* recognize_;
 #endif
+#ifdef TOUCH_USE_TRACE
+  TFT_eTouchTrace* trace_; ///< used trace, 0 when not tracing
+#endif // end TOUCH_USE_TRACE
+#ifdef TOUCH_USE_STATS
+  TouchStats  stats_; ///< stage durations and counters
+#endif // end TOUCH_USE_STATS
 
 #ifdef TOUCH_USE_PENIRQ_CODE
   volatile bool update_allowed_; ///< goes true when penirq happend
 #endif // end TOUCH_USE_PENIRQ_CODE
 
+#ifdef TOUCH_USE_TASK
+  SemaphoreHandle_t bus_mutex_; ///< taken while touch use spi bus
+  TaskHandle_t task_; ///< touch task woken by penirq, 0 when not running
+#endif // end TOUCH_USE_TASK
+
 private:
+#ifdef TOUCH_USE_PENIRQ_CODE
+  template <uint8_t N>
+  static void cb_isr_touch_fnk(); ///< penirq interrupt of dispatch table entry N
+  static TFT_eTouchBase* volatile isr_instances_[TOUCH_MAX_INSTANCES]; ///< penirq dispatch table
+  static void (* const isr_fnk_[TOUCH_MAX_INSTANCES])(); ///< interrupt function of each dispatch table entry
+#endif // end TOUCH_USE_PENIRQ_CODE
+
   inline bool is_touched();  ///< goes true when tuched (RZ != 0xffff)
   inline bool in_range(uint16_t measure); ///< mesure between raw_valid_min_ and raw_valid_max_?
   inline void spi_start(); ///< reserve spi bus and select chip 
   inline void spi_end(); ///< deselect chip and leave spi bus
+  inline uint8_t spi_transfer(uint8_t data); ///< exchange one byte with chip
+  inline uint16_t spi_transfer16(uint16_t data); ///< exchange two bytes with chip
+  inline void spi_transfer(uint8_t* buf, uint16_t count); ///< exchange count bytes with chip
   /// @sa update()
-  void        fetch_raw(bool only_z1);  ///< fetch raw values
+  void        fetch_raw(Measure& raw, bool only_z1);  ///< fetch raw values
+#ifdef TOUCH_MEASURE_POLICY
+  template <class S>
+  void        fetch_measure(Measure& raw, const S& s); ///< fetch raw values with measure strategie S (TOUCH_MEASURE_POLICY)
+#else
+  void        compile_program(); ///< compile measure strategie into program_
+  void        fetch_program(Measure& raw); ///< fetch raw values by running program_
+#endif // end TOUCH_MEASURE_POLICY
+#ifdef TOUCH_USE_BATCH_TRANSFER
+  bool        fetch_raw_batch(Measure& raw);  ///< fetch raw values with block transfer, false when strategie needs conversational fetch
+#endif // end TOUCH_USE_BATCH_TRANSFER
+  void        calc_rz(Measure& raw, bool has_touch); ///< calculate rz from raw values
+  void        fetch_z1(Measure& raw); ///< fetch only z1 with one 8 bit conversion, z1 is 0 when not touched
+  inline uint16_t read_measure(uint8_t next_ctrl); ///< start next conversion and return result of running conversion
+  inline uint16_t decode_measure(uint16_t data) const; ///< 12 bit value from read data, 8 bit results are rescaled
+  inline uint32_t measure_wait_us() const; ///< waiting time between measures in microseconds
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  void        adapt_wait(bool touched, bool only_z1); ///< adjust effective waiting time to fetched raw_, touched as fetched (unfiltered)
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+#ifdef TOUCH_USE_DECIMATION
+  bool        decimate(Measure& raw); ///< add fetched raw to decimator, true when raw is replaced by a decimated measure or not touched
+#endif // end TOUCH_USE_DECIMATION
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  void        fetch_queued(); ///< do the queued fetch
+#endif // end TOUCH_USE_DISPLAY_SYNC
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  bool        fetch_axis(uint8_t ctrl, uint16_t& value); ///< fetch one axis, false when not in range
+  bool        read_axis(uint8_t ctrl, uint16_t& value); ///< read one axis with measure strategie, conversion is started
+#endif // end TOUCH_USE_ASYNC_UPDATE
 
   uint8_t     drop_first_measures_; ///< ignore first n measures
   bool        z_once_measure_; ///< measure Z1 & Z2 only once (do not averaging)
@@ -376,29 +833,88 @@ private:
   bool        ignore_min_max_measure_; ///< when averaging do 2 measure more for dropping min max value in average result
 #endif // end TOUCH_USE_AVERAGING_CODE
 
+#ifndef TOUCH_MEASURE_POLICY
+  /// one step of the measure program
+  struct MeasureStep
+  {
+    uint8_t   ctrl; ///< control byte of the conversions
+    uint8_t   next; ///< control byte of the last conversion, starts the next step
+    uint8_t   op; ///< operation, target and flags
+    uint8_t   count; ///< number of conversions
+    uint8_t   drop; ///< dropped conversions before averaging
+  };
+  MeasureStep program_[8]; ///< measure strategie compiled by setMeasure() and setAveraging()
+  uint8_t     program_len_; ///< used steps in program_
+#endif // end TOUCH_MEASURE_POLICY
+
+  uint8_t     conversion_mode_; ///< MODE bit of control byte, set for 8 bit conversion
+
   uint16_t    raw_valid_min_; ///< raw measure minimum value for x, y, z1 and z2 (otherwise it is not touched)
   uint16_t    raw_valid_max_; ///< raw measure maximum value
 
   uint32_t    last_measure_time_us_; ///< last measure time in microseconds
   uint16_t    measure_wait_ms_; ///< waiting time in miliseconds between measures
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  uint16_t    adaptive_min_ms_; ///< waiting time after pen down or move
+  uint16_t    adaptive_max_ms_; ///< longest waiting time while pen stay, 0 when not adaptive
+  uint16_t    adaptive_idle_ms_; ///< waiting time when not touched
+  uint16_t    adaptive_move_; ///< raw distance recognized as move
+  uint16_t    effective_wait_ms_; ///< actual waiting time
+  uint16_t    adaptive_x_; ///< raw x of last touched fetch
+  uint16_t    adaptive_y_; ///< raw y of last touched fetch
+  bool        adaptive_touched_; ///< last full fetch was touched, otherwise next touched fetch is pen down
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+#ifdef TOUCH_USE_DISPLAY_SYNC
+  DisplayBusyFnk display_busy_fnk_; ///< display busy function, 0 when not used
+  void*       display_busy_ctx_; ///< given to display_busy_fnk_
+  uint8_t     fetch_pending_; ///< queued fetch: 0 none, 1 only z1, 2 all
+#endif // end TOUCH_USE_DISPLAY_SYNC
 
   uint16_t    rx_plate_; ///< Resitor value in ohm of x plate (300)
   uint16_t    rz_threshold_; ///< when RZ < RZ threshold we have a valid touch (default 3*RX-plate)
+
+#ifdef TOUCH_USE_ASYNC_UPDATE
+  bool        async_update_; ///< getRaw(), getXY() and get() do only one fetch step
+  uint8_t     acquire_step_; ///< next axis of running fetch (1..4), 0 when no fetch running
+  Measure     acquire_; ///< measure of running fetch
+#endif // end TOUCH_USE_ASYNC_UPDATE
   
+#ifdef TOUCH_USE_BUS
+  bool        bus_owned_; ///< TFT_eTouchBus hold the spi transaction
+#endif // end TOUCH_USE_BUS
+
+#ifdef TOUCH_USE_SAMPLER
+  TouchRing<Sample, TOUCH_SAMPLER_SIZE> samples_; ///< fetched samples
+  volatile uint16_t sampler_overruns_; ///< samples dropped, ring was full
+  volatile bool sampler_running_; ///< getRaw() take sample from ring
+  Measure     sampler_raw_; ///< last measure of sample(), only used by producer
+# ifdef ESP32
+  esp_timer_handle_t sampler_timer_; ///< periodic timer calling sample()
+  static void cb_sampler(void* arg); ///< esp_timer callback
+# endif
+#endif // end TOUCH_USE_SAMPLER
+
+#ifdef TOUCH_USE_DECIMATION
+  TouchDecimator<4> decimator_; ///< x, y, z1 and z2 of fetches reduced to one measure
+#endif // end TOUCH_USE_DECIMATION
+
 #ifdef TOUCH_USE_USER_CALIBRATION
   uint16_t    acurate_difference_; ///< tolerable noise on X and Y measure for same point
 #endif // TOUCH_USE_USER_CALIBRATION
 
 #ifdef TOUCH_FILTER_TYPE
 # ifdef TOUCH_X_FILTER 
-  TOUCH_X_FILTER *x_filter_;
+  TOUCH_X_FILTER x_filter_;
 # endif
 # ifdef TOUCH_Y_FILTER 
-  TOUCH_Y_FILTER *y_filter_;
+  TOUCH_Y_FILTER y_filter_;
 # endif
 # ifdef TOUCH_Z_FILTER 
-  TOUCH_Z_FILTER *z1_filter_;
-  TOUCH_Z_FILTER *z2_filter_;
+  TOUCH_Z_FILTER z1_filter_;
+  TOUCH_Z_FILTER z2_filter_;
+# endif
+# ifdef TOUCH_FILTER_BANK
+  TOUCH_FILTER_BANK filter_bank_; ///< filter for x, y (z1, z2) in one pass
 # endif
 #endif
 };
@@ -22,13 +22,32 @@ uint16_t TFT_eTouchBase::getRZ() const
 void TFT_eTouchBase::setCalibration(const Calibation& data)
 {
   calibation_ = data;
+  transform_rotation_ = 0xff;
+  setSPIClock(data.spi_clock * 100000UL);
 }
 
 TFT_eTouchBase::Calibation& TFT_eTouchBase::calibration()
 {
+  transform_rotation_ = 0xff; // caller may change it
   return calibation_;
 }
 
+void TFT_eTouchBase::invalidateTransform()
+{
+  transform_rotation_ = 0xff;
+}
+
+uint32_t TFT_eTouchBase::getSPIClock() const
+{
+  return spi_clock_;
+}
+
+bool TFT_eTouchBase::getCoarseTracking() const
+{
+  return conversion_mode_ != 0;
+}
+
+#ifndef TOUCH_MEASURE_POLICY
 void TFT_eTouchBase::setMeasure(uint8_t drop_first, bool z_once, bool z_first, bool z_local_min, uint8_t count)
 {
   drop_first_measures_ = drop_first;
@@ -37,6 +56,7 @@ void TFT_eTouchBase::setMeasure(uint8_t drop_first, bool z_once, bool z_first, b
   z_local_min_measure_ = z_local_min; 
   
   count_measure_ = count;
+  compile_program();
 }
 
 #ifdef TOUCH_USE_AVERAGING_CODE
@@ -44,8 +64,10 @@ void TFT_eTouchBase::setAveraging(bool averaging, bool ignore_min_max)
 {
   averaging_measure_ = averaging; 
   ignore_min_max_measure_ = ignore_min_max;
+  compile_program();
 }
 #endif // end TOUCH_USE_AVERAGING_CODE
+#endif // end TOUCH_MEASURE_POLICY
 
 void TFT_eTouchBase::setValidRawRange(uint16_t min, uint16_t max)
 {
@@ -63,6 +85,32 @@ uint16_t TFT_eTouchBase::getMeasureWait() const
   return measure_wait_ms_;
 }
 
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+uint16_t TFT_eTouchBase::getEffectiveWait() const
+{
+  return adaptive_max_ms_ ? effective_wait_ms_ : measure_wait_ms_;
+}
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+
+#ifdef TOUCH_USE_DECIMATION
+uint16_t TFT_eTouchBase::getDecimation() const
+{
+  return decimator_.ratio();
+}
+#endif // end TOUCH_USE_DECIMATION
+
+uint32_t TFT_eTouchBase::measure_wait_us() const
+{
+  uint32_t us = measure_wait_ms_ * 1000UL;
+#ifdef TOUCH_USE_ADAPTIVE_WAIT
+  if (adaptive_max_ms_) us = effective_wait_ms_ * 1000UL;
+#endif // end TOUCH_USE_ADAPTIVE_WAIT
+#ifdef TOUCH_USE_DECIMATION
+  us /= decimator_.ratio(); // one fetch per decimator input
+#endif // end TOUCH_USE_DECIMATION
+  return us;
+}
+
 
 void TFT_eTouchBase::setRXPlate(uint16_t ohm)
 {
@@ -86,18 +134,53 @@ void TFT_eTouchBase::reset()
 {
 #ifdef TOUCH_FILTER_TYPE
 # ifdef TOUCH_X_FILTER 
-  x_filter_->reset();
+  x_filter_.reset();
 # endif
 # ifdef TOUCH_Y_FILTER 
-  y_filter_->reset();
+  y_filter_.reset();
 # endif
 # ifdef TOUCH_Z_FILTER
-  z1_filter_->reset();
-  z2_filter_->reset();
+  z1_filter_.reset();
+  z2_filter_.reset();
+# endif
+# ifdef TOUCH_FILTER_BANK
+  filter_bank_.reset();
 # endif
 #endif
+#ifdef TOUCH_USE_DECIMATION
+  decimator_.reset();
+#endif // end TOUCH_USE_DECIMATION
+}
+
+#ifdef TOUCH_USE_ASYNC_UPDATE
+bool TFT_eTouchBase::updating() const
+{
+  return acquire_step_ != 0;
 }
 
+void TFT_eTouchBase::setAsyncUpdate(bool async)
+{
+  async_update_ = async;
+}
+#endif // end TOUCH_USE_ASYNC_UPDATE
+#ifdef TOUCH_USE_TASK
+void TFT_eTouchBase::setBusMutex(SemaphoreHandle_t mutex)
+{
+  bus_mutex_ = mutex;
+}
+
+SemaphoreHandle_t TFT_eTouchBase::busMutex() const
+{
+  return bus_mutex_;
+}
+#endif // end TOUCH_USE_TASK
+
+#ifdef TOUCH_USE_SAMPLER
+uint16_t TFT_eTouchBase::samplerOverruns() const
+{
+  return sampler_overruns_;
+}
+#endif // end TOUCH_USE_SAMPLER
 
 bool TFT_eTouchBase::valid()
 {
@@ -122,21 +205,156 @@ bool TFT_eTouchBase::is_touched()
   return raw_.rz != 0xffff;
 }
 
+int16_t TFT_eTouchBase::transform_axis(const TransformAxis& axis, const Measure& raw) const
+{
+  int32_t r = axis.from_y ? raw.y : raw.x;
+  int32_t v = ((r - axis.r0) * axis.a + axis.b) >> 16;
+  if (v < 0) return 0;
+  if (v > axis.max) return axis.max;
+  return v;
+}
+
 bool TFT_eTouchBase::in_range(uint16_t measure)
 {
+#ifdef TOUCH_USE_STATS
+  if ((measure < raw_valid_min_) || (measure > raw_valid_max_)) {
+    stats_.out_of_range++;
+    return false;
+  }
+  return true;
+#else
   return (measure >= raw_valid_min_) && (measure <= raw_valid_max_);
+#endif // end TOUCH_USE_STATS
+}
+
+#ifdef TOUCH_USE_TRACE
+void TFT_eTouchBase::setTrace(TFT_eTouchTrace* trace)
+{
+  trace_ = trace;
+}
+
+TFT_eTouchTrace* TFT_eTouchBase::getTrace() const
+{
+  return trace_;
+}
+#endif // end TOUCH_USE_TRACE
+
+#ifdef TOUCH_USE_STATS
+const TouchStats& TFT_eTouchBase::stats() const
+{
+  return stats_;
+}
+
+void TFT_eTouchBase::resetStats()
+{
+  stats_.reset();
+}
+#endif // end TOUCH_USE_STATS
+
+#ifdef TOUCH_USE_DISPLAY_SYNC
+bool TFT_eTouchBase::fetchPending() const
+{
+  return fetch_pending_ != 0;
+}
+
+bool TFT_eTouchBase::display_busy()
+{
+  return display_busy_fnk_ && display_busy_fnk_(display_busy_ctx_);
 }
+#endif // end TOUCH_USE_DISPLAY_SYNC
 
 void TFT_eTouchBase::spi_start()
 {
-	spi_.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+#ifdef TOUCH_USE_TRACE
+  if (trace_) {
+    trace_->begin();
+    if (trace_->mode() == TFT_eTouchTrace::replaying) return; // chip not used
+  }
+#endif // end TOUCH_USE_TRACE
+#ifdef TOUCH_USE_BUS
+  if (!bus_owned_) {
+#endif // end TOUCH_USE_BUS
+#ifdef TOUCH_USE_TASK
+  if (bus_mutex_) xSemaphoreTake(bus_mutex_, portMAX_DELAY);
+#endif // end TOUCH_USE_TASK
+	spi_.beginTransaction(spi_settings_);
+#ifdef TOUCH_USE_BUS
+  }
+#endif // end TOUCH_USE_BUS
 	digitalWrite(cs_, LOW);
 }
 
+uint8_t TFT_eTouchBase::spi_transfer(uint8_t data)
+{
+#ifdef TOUCH_USE_STATS
+  if (data & 0x80) stats_.conversions++;
+#endif // end TOUCH_USE_STATS
+#ifdef TOUCH_USE_TRACE
+  if (trace_) return trace_->transfer(data, spi_);
+#endif // end TOUCH_USE_TRACE
+  return spi_.transfer(data);
+}
+
+uint16_t TFT_eTouchBase::spi_transfer16(uint16_t data)
+{
+#ifdef TOUCH_USE_STATS
+  if (data & 0x80) stats_.conversions++; // control byte is the second byte
+#endif // end TOUCH_USE_STATS
+#ifdef TOUCH_USE_TRACE
+  if (trace_) {
+    uint16_t hi = trace_->transfer(data >> 8, spi_);
+    return (hi << 8) | trace_->transfer(data & 0xff, spi_);
+  }
+#endif // end TOUCH_USE_TRACE
+  return spi_.transfer16(data);
+}
+
+void TFT_eTouchBase::spi_transfer(uint8_t* buf, uint16_t count)
+{
+#ifdef TOUCH_USE_STATS
+  for (uint16_t i = 0; i < count; i++) {
+    if (buf[i] & 0x80) stats_.conversions++;
+  }
+#endif // end TOUCH_USE_STATS
+#ifdef TOUCH_USE_TRACE
+  if (trace_) {
+    for (uint16_t i = 0; i < count; i++) buf[i] = trace_->transfer(buf[i], spi_);
+    return;
+  }
+#endif // end TOUCH_USE_TRACE
+  spi_.transfer(buf, count);
+}
+
+uint16_t TFT_eTouchBase::read_measure(uint8_t next_ctrl)
+{
+  return decode_measure(spi_transfer16(next_ctrl | conversion_mode_));
+}
+
+uint16_t TFT_eTouchBase::decode_measure(uint16_t data) const
+{
+  if (conversion_mode_) {
+    data = (data >> 7) & 0xff;
+    return (data << 4) | (data >> 4);
+  }
+  return (data >> 3) & 0x0fff;
+}
+
 void TFT_eTouchBase::spi_end()
 {
+#ifdef TOUCH_USE_TRACE
+  if (trace_) {
+    trace_->finish();
+    if (trace_->mode() == TFT_eTouchTrace::replaying) return; // chip not used
+  }
+#endif // end TOUCH_USE_TRACE
 	digitalWrite(cs_, HIGH);
+#ifdef TOUCH_USE_BUS
+  if (bus_owned_) return; // TFT_eTouchBus end the transaction
+#endif // end TOUCH_USE_BUS
 	spi_.endTransaction();
+#ifdef TOUCH_USE_TASK
+  if (bus_mutex_) xSemaphoreGive(bus_mutex_);
+#endif // end TOUCH_USE_TASK
 }
 
 #endif // TFT_E_TOUCH_BASE_INL
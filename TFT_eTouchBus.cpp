@@ -0,0 +1,73 @@
+//
+//  TFT_eTouchBus.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <TFT_eTouchBus.h>
+
+#ifdef TOUCH_USE_BUS
+
+TFT_eTouchBus::TFT_eTouchBus(SPIClass& spi)
+: spi_(spi)
+, size_(0)
+, next_(0)
+{
+}
+
+bool TFT_eTouchBus::add(TFT_eTouchBase& touch)
+{
+  if (size_ >= TOUCH_MAX_INSTANCES || &touch.spi_ != &spi_) {
+#ifdef TOUCH_SERIAL_DEBUG
+    if (Serial) Serial.println("TFT_eTouchBus::add() touch not added");
+#endif
+    return false;
+  }
+  touch_[size_++] = &touch;
+  return true;
+}
+
+uint8_t TFT_eTouchBus::update(uint8_t max_fetches)
+{
+  if (size_ == 0) return 0;
+
+  uint32_t hz = 0xffffffff;
+  for (uint8_t i = 0; i < size_; i++) {
+    if (touch_[i]->getSPIClock() < hz) hz = touch_[i]->getSPIClock();
+  }
+
+#ifdef TOUCH_USE_TASK
+  SemaphoreHandle_t mutex = touch_[0]->bus_mutex_;
+  if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+#endif // end TOUCH_USE_TASK
+  spi_.beginTransaction(SPISettings(hz, MSBFIRST, SPI_MODE0));
+
+  uint8_t fetches = 0;
+  uint8_t start = next_;
+  for (uint8_t n = 0; n < size_ && fetches < max_fetches; n++) {
+    uint8_t i = start + n;
+    if (i >= size_) i -= size_;
+    TFT_eTouchBase* touch = touch_[i];
+    touch->bus_owned_ = true;
+    bool fetched = touch->update(false);
+    touch->bus_owned_ = false;
+    if (fetched) {
+      fetches++;
+      next_ = (i + 1 < size_) ? i + 1 : 0;
+    }
+  }
+
+  spi_.endTransaction();
+#ifdef TOUCH_USE_TASK
+  if (mutex) xSemaphoreGive(mutex);
+#endif // end TOUCH_USE_TASK
+  return fetches;
+}
+
+#endif // end TOUCH_USE_BUS
@@ -0,0 +1,63 @@
+#ifndef TFT_E_TOUCH_BUS_H
+#define TFT_E_TOUCH_BUS_H
+
+//
+//  TFT_eTouchBus.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <TFT_eTouchBase.h>
+
+#ifdef TOUCH_USE_BUS
+
+/** 
+  * Several touch controllers with own chip select on one spi bus.
+  * update() take the bus once and fetch the instances round robin, starting after the last fetched one.
+  * The spi transaction use the slowest spi clock of all added instances.
+  * @brief  touch controllers sharing one spi bus
+  */
+class TFT_eTouchBus
+{
+public:
+/** 
+  * @brief  constructor
+  * @param  spi used bus, all added instances must use it
+  */
+            TFT_eTouchBus(SPIClass& spi = SPI);
+
+/** 
+  * Add a touch instance, call it after init() of the instance.
+  * @brief  add touch
+  * @param  touch instance to fetch with update()
+  * @return false when TOUCH_MAX_INSTANCES are added or touch use an other spi bus
+  */
+  bool      add(TFT_eTouchBase& touch);
+
+/** 
+  * Fetch the instances whose measure waiting time is over, all within one spi transaction.
+  * The instances keep their raw values, read them as usual.
+  * @brief  update all instances
+  * @param  max_fetches maximal fetches in this call, the next call continue with the following instance
+  * @return number of fetched instances
+  */
+  uint8_t   update(uint8_t max_fetches = TOUCH_MAX_INSTANCES);
+
+  inline uint8_t size() const { return size_; } ///< number of added instances
+
+private:
+  SPIClass& spi_; ///< the shared bus
+  TFT_eTouchBase* touch_[TOUCH_MAX_INSTANCES]; ///< added instances
+  uint8_t   size_; ///< number of added instances
+  uint8_t   next_; ///< instance fetched first on next update()
+};
+
+#endif // end TOUCH_USE_BUS
+
+#endif // TFT_E_TOUCH_BUS_H
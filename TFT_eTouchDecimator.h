@@ -0,0 +1,109 @@
+#ifndef TFT_E_TOUCH_DECIMATOR_H
+#define TFT_E_TOUCH_DECIMATOR_H
+
+//
+//  TFT_eTouchDecimator.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+
+#ifndef TOUCH_DECIMATION_ORDER
+#define TOUCH_DECIMATION_ORDER 2
+#endif
+
+/**
+  * Cascaded integrator comb (CIC) decimator for 12 bit measures. Order 1 is a boxcar average of ratio values.
+  * Every input sample costs Order additions per channel, every ratio'th sample the combs
+  * give one output with Order subtractions and a shift. The registers are 32 bit and may wrap,
+  * the comb differences are exact as long 12 + Order * log2(ratio) bits fit, setRatio() keep this.
+  * The output is valid after Order outputs (the integrators start empty).
+  * @brief  cic decimator
+  * @param  Channels number of values per sample
+  * @param  Order number of integrator and comb stages (1..3)
+  */
+template <uint8_t Channels = 4, uint8_t Order = TOUCH_DECIMATION_ORDER>
+class TouchDecimator
+{
+  static_assert(Order >= 1 && Order <= 3, "decimator order must be 1..3");
+
+public:
+  TouchDecimator()
+  : shift_(0)
+  {
+    reset();
+  }
+
+/**
+  * @brief  set decimation ratio, reset the decimator
+  * @param  ratio input samples per output, rounded down to a power of two (1 is off)
+  */
+  void setRatio(uint16_t ratio)
+  {
+    uint8_t shift = 0;
+    while ((2U << shift) <= ratio && 12 + Order * (shift + 1) <= 32) shift++;
+    shift_ = shift;
+    reset();
+  }
+
+  inline uint16_t ratio() const ///< input samples per output
+  {
+    return 1U << shift_;
+  }
+
+  inline void reset()
+  {
+    memset(integrator_, 0, sizeof(integrator_));
+    memset(comb_, 0, sizeof(comb_));
+    phase_ = 0;
+    outputs_ = 0;
+  }
+
+/**
+  * @brief  add one input sample
+  * @param  in Channels values
+  * @param  out Channels decimated values, written when true is returned
+  * @return true when a valid output is written
+  */
+  bool add(const uint16_t* in, uint16_t* out)
+  {
+    for (uint8_t c = 0; c < Channels; c++) {
+      uint32_t v = in[c];
+      for (uint8_t s = 0; s < Order; s++) {
+        integrator_[c][s] += v;
+        v = integrator_[c][s];
+      }
+    }
+    if (++phase_ < ratio()) return false;
+    phase_ = 0;
+
+    uint8_t gain = Order * shift_; // ratio^Order
+    for (uint8_t c = 0; c < Channels; c++) {
+      uint32_t v = integrator_[c][Order - 1];
+      for (uint8_t s = 0; s < Order; s++) {
+        uint32_t d = v - comb_[c][s];
+        comb_[c][s] = v;
+        v = d;
+      }
+      out[c] = (v + (1UL << gain >> 1)) >> gain;
+    }
+    if (outputs_ < Order) outputs_++;
+    return outputs_ == Order;
+  }
+
+private:
+  uint32_t integrator_[Channels][Order]; ///< running sums of the input
+  uint32_t comb_[Channels][Order]; ///< comb delay, value of the last output
+  uint16_t phase_; ///< input samples since last output
+  uint8_t  outputs_; ///< outputs since reset, valid when Order
+  uint8_t  shift_; ///< log2 of ratio
+};
+
+#endif // TFT_E_TOUCH_DECIMATOR_H
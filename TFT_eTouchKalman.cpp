@@ -0,0 +1,86 @@
+//
+//  TFT_eTouchKalman.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <TFT_eTouchKalman.h>
+
+#define MAX_GAP_US 100000UL
+#define START_VELOCITY_VARIANCE (512LL * 512) // 2 pixel/ms
+
+TouchKalman::TouchKalman()
+: p_(0)
+, v_(0)
+, p00_(0)
+, p01_(0)
+, p11_(0)
+, last_us_(0)
+, measure_noise_(8)
+, accel_noise_(4)
+, tracking_(false)
+{
+}
+
+void TouchKalman::setNoise(uint16_t measure, uint16_t accel)
+{
+  measure_noise_ = measure;
+  accel_noise_ = accel;
+}
+
+void TouchKalman::reset()
+{
+  tracking_ = false;
+}
+
+void TouchKalman::update(int16_t pos, uint32_t us)
+{
+  int32_t z = (int32_t)pos << 4;
+  int64_t r = (int64_t)measure_noise_ * measure_noise_;
+  uint32_t gap = us - last_us_;
+  last_us_ = us;
+  if (!tracking_ || gap > MAX_GAP_US) {
+    p_ = z;
+    v_ = 0;
+    p00_ = r;
+    p01_ = 0;
+    p11_ = START_VELOCITY_VARIANCE;
+    tracking_ = true;
+    return;
+  }
+
+  // predict, dt in 1/16 ms: p += v * dt
+  int64_t dt = (gap * 16 + 500) / 1000;
+  if (dt > 0) {
+    p_ += (int32_t)((v_ * dt + 128) >> 8);
+    // white acceleration over dt: position qp (1/16 of 1/16 pixel), velocity qv (1/16 of 1/256 pixel/ms)
+    int64_t qp = (int64_t)accel_noise_ * dt * dt / 512;
+    int64_t qv = (int64_t)accel_noise_ * dt;
+    p00_ += (2 * dt * p01_ >> 8) + (dt * dt * p11_ >> 16) + (qp * qp >> 8);
+    p01_ += (dt * p11_ >> 8) + (qp * qv >> 8);
+    p11_ += qv * qv >> 8;
+  }
+
+  // correct
+  int64_t s = p00_ + r;
+  int64_t y = z - p_;
+  p_ += (int32_t)(p00_ * y / s);
+  v_ += (int32_t)(p01_ * y / s);
+  p11_ -= p01_ * p01_ / s;
+  p01_ = p01_ * r / s;
+  p00_ = p00_ * r / s;
+}
+
+int16_t TouchKalman::predict(uint32_t us_ahead) const
+{
+  if (us_ahead > MAX_GAP_US) us_ahead = MAX_GAP_US;
+  int64_t dt = (us_ahead * 16 + 500) / 1000;
+  int32_t p = p_ + (int32_t)((v_ * dt + 128) >> 8);
+  return (int16_t)((p + 8) >> 4);
+}
@@ -0,0 +1,70 @@
+#ifndef TFT_E_TOUCH_KALMAN_H
+#define TFT_E_TOUCH_KALMAN_H
+
+//
+//  TFT_eTouchKalman.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+
+/** 
+  * Kalman filter for one display axis with a constant velocity model (position and velocity, white acceleration noise).
+  * It estimates the pen velocity from the measured positions, so the position some ms ahead can be predicted.
+  *
+  * Integer only: position in 1/16 pixel, velocity in 1/256 pixel/ms, time in 1/16 ms, covariance in 64 bit.
+  * A measure more than 100 ms after the last one starts a new track.
+  * @brief  position and velocity tracker
+  */
+class TouchKalman
+{
+public:
+            TouchKalman();
+
+/** 
+  * @brief  set noise
+  * @param  measure standard deviation of the measured position in 1/16 pixel (default 8)
+  * @param  accel standard deviation of the pen acceleration in 1/256 pixel/ms² (default 4), higher follow direction changes faster
+  */
+  void      setNoise(uint16_t measure, uint16_t accel);
+
+  void      reset(); ///< forget the track
+
+/** 
+  * @brief  add measure
+  * @param  pos measured position in pixel
+  * @param  us micros() of the measure
+  */
+  void      update(int16_t pos, uint32_t us);
+
+/** 
+  * @brief  predicted position
+  * @param  us_ahead time after the last measure
+  * @return position in pixel
+  */
+  int16_t   predict(uint32_t us_ahead) const;
+
+  inline bool    tracking() const { return tracking_; } ///< true after the first measure
+  inline int32_t velocity() const { return v_; } ///< estimated velocity in 1/256 pixel/ms
+  inline uint32_t lastUpdate() const { return last_us_; } ///< micros() of the last measure
+
+private:
+  int32_t   p_;   ///< position in 1/16 pixel
+  int32_t   v_;   ///< velocity in 1/256 pixel/ms
+  int64_t   p00_; ///< position variance
+  int64_t   p01_; ///< covariance position, velocity
+  int64_t   p11_; ///< velocity variance
+  uint32_t  last_us_;
+  uint16_t  measure_noise_;
+  uint16_t  accel_noise_;
+  bool      tracking_;
+};
+
+#endif // TFT_E_TOUCH_KALMAN_H
@@ -0,0 +1,231 @@
+#ifndef TFT_E_TOUCH_LOG_H
+#define TFT_E_TOUCH_LOG_H
+
+//
+//  TFT_eTouchLog.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+#include <TFT_eTouchRing.h>
+
+#ifndef TOUCH_LOG_SIZE
+#define TOUCH_LOG_SIZE 32
+#endif
+
+/// record ids of TouchLog
+typedef enum
+{
+  log_out_of_range,       ///< a: value, b: ctrl
+  log_block_out_of_range, ///< a: value
+  log_x_filter_fill,      ///< a: filled, b: size, c: raw x
+  log_y_filter_fill,      ///< a: filled, b: size, c: raw y
+  log_filter_ready,       ///< a: N, b: shift
+  log_penirq,             ///< a: penirq pin
+  log_user                ///< first id free for the sketch, printed with its arguments
+} TouchLogId;
+
+/**
+  * One log record, 14 bytes (16 with alignment).
+  * @brief  log record
+  */
+struct TouchLogEntry
+{
+  uint32_t  us;     ///< micros() when added
+  uint16_t  a;      ///< first argument
+  uint16_t  b;      ///< second argument
+  uint16_t  c;      ///< third argument
+  volatile uint16_t pos; ///< sequence number, set after the record is written
+  uint8_t   id;     ///< TouchLogId
+};
+
+/**
+  * Binary event log for debugging the hot paths without Serial. add() only reserve a slot and store a record,
+  * it's lock free (on AVR and ESP8266 the slot is reserved with interrupts disabled for two instructions) and can be called from interrupts.
+  * When the reader is too slow the oldest records are overwritten and counted as dropped.
+  * Records are numbered with 16 bit sequence numbers, up to 65535 - N records can be lost between two flush() calls.
+  * flush() format the records to a Print, call it from loop() when there is time or on demand.
+  * @brief  lock free log ring
+  * @param  N number of records, must be a power of two
+  */
+template <uint8_t N = 32>
+class TouchLog
+{
+  static_assert((N & (N - 1)) == 0 && N <= 128, "N must be a power of two up to 128");
+
+public:
+  TouchLog()
+  : head_(0)
+  , tail_(0)
+  , dropped_(0)
+  {
+    for (uint8_t i = 0; i < N; i++) data_[i].pos = i - 2 * N; // not written
+  }
+
+/**
+  * Can be called from interrupt.
+  * @brief  add record
+  * @param  id TouchLogId
+  * @param  a first argument
+  * @param  b second argument
+  * @param  c third argument
+  */
+  void add(uint8_t id, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0)
+  {
+    uint16_t pos;
+#if defined (__AVR__)
+    uint8_t sreg = SREG;
+    cli();
+    pos = head_++;
+    SREG = sreg;
+#elif defined (ESP8266)
+    uint32_t ps = xt_rsil(15);
+    pos = head_++;
+    xt_wsr_ps(ps);
+#else
+    pos = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+#endif
+    TouchLogEntry& e = data_[pos & (N - 1)];
+    e.pos = pos - 2 * N; // invalid while writing, differ from the overwritten record pos - N
+    TOUCH_MEMORY_BARRIER();
+    e.us = micros();
+    e.id = id;
+    e.a = a;
+    e.b = b;
+    e.c = c;
+    TOUCH_MEMORY_BARRIER(); // record is written before it's valid
+    e.pos = pos;
+  }
+
+/**
+  * Only one reader at a time.
+  * @brief  get oldest record
+  * @param  e set to oldest record
+  * @return false when log is empty or the oldest record is still written
+  */
+  bool pop(TouchLogEntry& e)
+  {
+    uint16_t head = load_head();
+    if ((uint16_t)(head - tail_) > N) { // overwritten
+      dropped_ += (uint16_t)(head - tail_) - N;
+      tail_ = head - N;
+    }
+    while (tail_ != head) {
+      const TouchLogEntry& slot = data_[tail_ & (N - 1)];
+      if (slot.pos != tail_) return false; // still written
+      TOUCH_MEMORY_BARRIER();
+      e.us = slot.us;
+      e.id = slot.id;
+      e.a = slot.a;
+      e.b = slot.b;
+      e.c = slot.c;
+      TOUCH_MEMORY_BARRIER();
+      bool valid = slot.pos == tail_; // not overwritten while copied
+      tail_++;
+      if (valid) return true;
+      dropped_++;
+    }
+    return false;
+  }
+
+/**
+  * @brief  print records
+  * @param  out e.g. Serial
+  * @param  max maximal number of printed records
+  * @return number of printed records
+  */
+  uint8_t flush(Print& out, uint8_t max = N)
+  {
+    uint8_t n = 0;
+    TouchLogEntry e;
+    while (n < max && pop(e)) {
+      print(out, e);
+      n++;
+    }
+    if (dropped_) {
+      out.print(dropped_);
+      out.println(" log records dropped");
+      dropped_ = 0;
+    }
+    return n;
+  }
+
+  static void print(Print& out, const TouchLogEntry& e)
+  {
+    out.print(e.us);
+    out.print(": ");
+    switch (e.id) {
+    case log_out_of_range:
+      out.print("raw measure out of range value: ");
+      out.print(e.a);
+      out.print(" ctrl: 0x");
+      out.println(e.b, BIN);
+      break;
+    case log_block_out_of_range:
+      out.print("raw block measure out of range value: ");
+      out.println(e.a);
+      break;
+    case log_x_filter_fill:
+    case log_y_filter_fill:
+      out.print(e.a);
+      out.print('/');
+      out.print(e.b);
+      out.print(e.id == log_x_filter_fill ? " x filter fill " : " y filter fill ");
+      out.println(e.c);
+      break;
+    case log_filter_ready:
+      out.print("filter ready N: ");
+      out.print(e.a);
+      out.print(" shift: ");
+      out.println(e.b);
+      break;
+    case log_penirq:
+      out.print("penirq ");
+      out.println(e.a);
+      break;
+    default:
+      out.print("id ");
+      out.print(e.id);
+      out.print(": ");
+      out.print(e.a);
+      out.print(", ");
+      out.print(e.b);
+      out.print(", ");
+      out.println(e.c);
+    }
+  }
+
+  inline uint16_t dropped() const { return dropped_; } ///< records lost since last flush()
+
+private:
+  inline uint16_t load_head() const
+  {
+#if defined (__AVR__)
+    uint8_t sreg = SREG; // 16 bit read is not atomic
+    cli();
+    uint16_t head = head_;
+    SREG = sreg;
+    return head;
+#else
+    return head_;
+#endif
+  }
+
+  TouchLogEntry data_[N];
+  volatile uint16_t head_; ///< next sequence number, reserved by writers
+  uint16_t tail_; ///< next sequence number to read, only changed by reader
+  uint16_t dropped_; ///< lost records
+};
+
+extern TouchLog<TOUCH_LOG_SIZE> touch_log; ///< log of the library, defined in TFT_eTouchBase.cpp
+
+#define TOUCH_LOG(id, ...) touch_log.add(id, ##__VA_ARGS__)
+
+#endif // TFT_E_TOUCH_LOG_H
@@ -0,0 +1,47 @@
+#ifndef TFT_E_TOUCH_POLICY_H
+#define TFT_E_TOUCH_POLICY_H
+
+//
+//  TFT_eTouchPolicy.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+/**
+  * Measure strategie fixed at compile time. The parameters are the same as TFT_eTouchBase::setMeasure() and TFT_eTouchBase::setAveraging().
+  * Used when TOUCH_MEASURE_POLICY is defined, the compiler then removes the code of the not used strategies from the fetch.
+@code
+#define TOUCH_MEASURE_POLICY MeasurePolicy<0, false, true, false, 2> // z first, take 2'th z,x,y
+@endcode
+  * @brief  compile time measure strategie
+  * @param  Drop ignore first n measures
+  * @param  ZOnce read z1 and z2 only once
+  * @param  ZFirst start measure with Z1 otherwise with X
+  * @param  ZLocalMin get local minimum of RZ
+  * @param  Count how many values used by averaging or witch measure is taken. 0 means read until measure is equal last measure
+  * @param  Averaging averaging Count measure, otherwise take the Count measure
+  * @param  IgnoreMinMax ignore min and max value on averaging
+  */
+template <uint8_t Drop, bool ZOnce, bool ZFirst, bool ZLocalMin, uint8_t Count, bool Averaging = false, bool IgnoreMinMax = false>
+struct MeasurePolicy
+{
+#ifndef TOUCH_USE_AVERAGING_CODE
+  static_assert(!Averaging, "averaging policy needs TOUCH_USE_AVERAGING_CODE");
+#endif
+
+  static inline uint8_t drop() { return Drop; }
+  static inline bool    z_once() { return ZOnce; }
+  static inline bool    z_first() { return ZFirst || ZOnce; } // z_once set z_first
+  static inline bool    z_local_min() { return ZLocalMin; }
+  static inline bool    averaging() { return Averaging; }
+  static inline bool    ignore_min_max() { return Averaging && IgnoreMinMax; }
+  static inline uint8_t count() { return Count; } // averaging sum is 32 bit, all 255 measures fit
+};
+
+#endif // TFT_E_TOUCH_POLICY_H
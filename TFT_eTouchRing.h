@@ -0,0 +1,96 @@
+#ifndef TFT_E_TOUCH_RING_H
+#define TFT_E_TOUCH_RING_H
+
+//
+//  TFT_eTouchRing.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#if defined (__AVR__) || defined (ESP8266)
+// single core, a compiler barrier is enough
+# define TOUCH_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+# define TOUCH_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+/**
+  * Lock free ring for one producer (e.g. timer callback) and one consumer (e.g. loop()).
+  * The producer only write head_ and the consumer only write tail_, both are 8 bit for atomic access on all processors.
+  * @brief  single producer single consumer ring
+  * @param  T stored type
+  * @param  N number of entries, must be a power of two and not greater than 128
+  */
+template <class T, uint8_t N = 16>
+class TouchRing
+{
+  static_assert((N & (N - 1)) == 0 && N <= 128, "N must be a power of two and not greater than 128");
+
+public:
+  TouchRing()
+  : head_(0)
+  , tail_(0)
+  {
+  }
+
+/**
+  * Only called by producer.
+  * @brief  add entry
+  * @param  val entry to add
+  * @return false when ring is full, val is dropped
+  */
+  bool push(const T& val)
+  {
+    uint8_t head = head_;
+    if ((uint8_t)(head - tail_) >= N) return false;
+    data_[head & (N - 1)] = val;
+    TOUCH_MEMORY_BARRIER(); // entry is written before head is moved
+    head_ = head + 1;
+    return true;
+  }
+
+/**
+  * Only called by consumer.
+  * @brief  remove oldest entry
+  * @param  val set to oldest entry
+  * @return false when ring is empty, val is not set
+  */
+  bool pop(T& val)
+  {
+    uint8_t tail = tail_;
+    if (tail == head_) return false;
+    TOUCH_MEMORY_BARRIER(); // head is read before entry
+    val = data_[tail & (N - 1)];
+    TOUCH_MEMORY_BARRIER(); // entry is read before tail is moved
+    tail_ = tail + 1;
+    return true;
+  }
+
+  inline uint8_t size() const
+  {
+    return N;
+  }
+
+  inline uint8_t used() const
+  {
+    return (uint8_t)(head_ - tail_);
+  }
+
+  inline bool empty() const
+  {
+    return head_ == tail_;
+  }
+
+private:
+  T data_[N];
+  volatile uint8_t head_; ///< next write position, only changed by producer
+  volatile uint8_t tail_; ///< next read position, only changed by consumer
+};
+
+#endif // TFT_E_TOUCH_RING_H
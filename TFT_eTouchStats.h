@@ -0,0 +1,173 @@
+#ifndef TFT_E_TOUCH_STATS_H
+#define TFT_E_TOUCH_STATS_H
+
+//
+//  TFT_eTouchStats.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#if defined (ESP32) || defined (ESP8266)
+// cpu cycle counter
+# define TOUCH_STATS_TICKS() ESP.getCycleCount()
+# define TOUCH_STATS_TICKS_PER_US (F_CPU / 1000000)
+# define TOUCH_STATS_BUCKETS 48 // up to 2^24 cycles, 70 ms at 240 MHz
+#else
+# define TOUCH_STATS_TICKS() micros()
+# define TOUCH_STATS_TICKS_PER_US 1
+# define TOUCH_STATS_BUCKETS 32 // up to 65 ms
+#endif
+
+/**
+  * Duration histogram with TOUCH_STATS_BUCKETS fixed buckets, two per octave of ticks (cpu cycles on ESP, otherwise microseconds):
+  * [0,1) [1,2) [2,3) [3,4) [4,6) [6,8) [8,12) .. Longer durations are counted in the last bucket.
+  * Minimum, maximum and sum are kept exact in ticks.
+  * @brief  duration histogram
+  */
+class TouchHistogram
+{
+public:
+  enum { buckets = TOUCH_STATS_BUCKETS };
+
+  TouchHistogram()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    for (uint8_t i = 0; i < buckets; i++) bucket_[i] = 0;
+    count_ = 0;
+    min_ = 0xffffffff;
+    max_ = 0;
+    sum_ = 0;
+  }
+
+/**
+  * @brief  add duration
+  * @param  ticks duration in ticks, see TOUCH_STATS_TICKS()
+  */
+  inline void add(uint32_t ticks)
+  {
+    count_++;
+    sum_ += ticks;
+    if (ticks < min_) min_ = ticks;
+    if (ticks > max_) max_ = ticks;
+    bucket_[index(ticks)]++;
+  }
+
+  inline uint32_t count() const { return count_; } ///< number of durations
+  inline uint32_t minTicks() const { return count_ ? min_ : 0; } ///< shortest duration in ticks
+  inline uint32_t maxTicks() const { return max_; } ///< longest duration in ticks
+  inline uint32_t meanTicks() const { return count_ ? (uint32_t)(sum_ / count_) : 0; } ///< mean duration in ticks
+  inline uint32_t bucket(uint8_t i) const { return bucket_[i]; } ///< durations in bucket i
+
+/**
+  * @brief  percentile
+  * @param  p percent (e.g. 50, 99)
+  * @return upper limit in ticks of the bucket holding the p'th percentile (not above maximum), 0 when empty
+  */
+  uint32_t percentile(uint8_t p) const
+  {
+    if (count_ == 0) return 0;
+    uint32_t target = (uint32_t)(((uint64_t)count_ * p + 99) / 100);
+    if (target == 0) target = 1;
+    uint32_t sum = 0;
+    uint8_t i = 0;
+    for (; i < buckets - 1; i++) {
+      sum += bucket_[i];
+      if (sum >= target) break;
+    }
+    return upper(i) < max_ ? upper(i) : max_;
+  }
+
+  static uint8_t index(uint32_t ticks) ///< bucket of duration in ticks
+  {
+    if (ticks < 2) return ticks;
+    uint8_t msb = 31 - __builtin_clz(ticks);
+    uint8_t i = 2 * msb + ((ticks >> (msb - 1)) & 1);
+    return i < buckets ? i : buckets - 1;
+  }
+
+  static uint32_t upper(uint8_t i) ///< first duration in ticks after bucket i
+  {
+    if (i < 2) return i + 1;
+    uint8_t msb = i >> 1;
+    uint32_t step = 1ul << (msb - 1);
+    return (1ul << msb) + (i & 1) * step + step;
+  }
+
+private:
+  uint32_t bucket_[buckets];
+  uint32_t count_;
+  uint32_t min_;
+  uint32_t max_;
+  uint64_t sum_;
+};
+
+/**
+  * Durations of each touch stage and event counters, read them with TFT_eTouchBase::stats().
+  * @brief  touch statistics
+  */
+struct TouchStats
+{
+  TouchHistogram acquire;   ///< spi fetch of one measure (fetch_raw(), including rz)
+  TouchHistogram rz;        ///< rz calculation (part of acquire)
+  TouchHistogram filter;    ///< fir filter of one measure
+  TouchHistogram transform; ///< transform to display coordinates
+  uint32_t conversions;     ///< conversions started on the touch chip
+  uint32_t out_of_range;    ///< conversions rejected by the valid raw range
+  uint32_t filter_drops;    ///< measures dropped while the filter fills
+  volatile uint32_t penirq_wakeups; ///< penirq interrupts
+
+  TouchStats()
+  : conversions(0)
+  , out_of_range(0)
+  , filter_drops(0)
+  , penirq_wakeups(0)
+  {
+  }
+
+  void reset()
+  {
+    acquire.reset();
+    rz.reset();
+    filter.reset();
+    transform.reset();
+    conversions = 0;
+    out_of_range = 0;
+    filter_drops = 0;
+    penirq_wakeups = 0;
+  }
+};
+
+/**
+  * Add the time from construction to destruction to a histogram.
+  * @brief  scoped stage timer
+  */
+class TouchStatsTimer
+{
+public:
+  TouchStatsTimer(TouchHistogram& histogram)
+  : histogram_(histogram)
+  , start_(TOUCH_STATS_TICKS())
+  {
+  }
+
+  ~TouchStatsTimer()
+  {
+    histogram_.add(TOUCH_STATS_TICKS() - start_);
+  }
+
+private:
+  TouchHistogram& histogram_;
+  uint32_t start_;
+};
+
+#endif // TFT_E_TOUCH_STATS_H
@@ -0,0 +1,154 @@
+//
+//  TFT_eTouchTrace.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <TFT_eTouchTrace.h>
+
+#define TRACE_RECORD 0x00
+#define TRACE_RECORD_SIZE 5
+#define TRACE_CONVERSION_SIZE 3
+#define START_BIT 0x80
+#define MODE_8BIT 0b00001000
+
+TFT_eTouchTrace::TFT_eTouchTrace(uint8_t* buf, uint32_t size, uint32_t used)
+: buf_(buf)
+, size_(size)
+, used_(used < size ? used : size)
+, mode_(off)
+, full_(false)
+, time_(0)
+, begin_(0)
+, next_(0)
+, pending_(false)
+, pending_ctrl_(0)
+, shift_ctrl_(0)
+, shift_bytes_(0)
+, shift_word_(0)
+{
+}
+
+void TFT_eTouchTrace::record()
+{
+  used_ = 0;
+  full_ = false;
+  mode_ = recording;
+}
+
+void TFT_eTouchTrace::replay()
+{
+  next_ = 0;
+  time_ = 0;
+  for (uint8_t i = 0; i < 8; i++) last_[i] = 0;
+  mode_ = replaying;
+}
+
+void TFT_eTouchTrace::stop()
+{
+  mode_ = off;
+}
+
+void TFT_eTouchTrace::begin()
+{
+  pending_ = false;
+  shift_bytes_ = 0;
+  if (mode_ == recording) {
+    if (full_ || used_ + TRACE_RECORD_SIZE + TRACE_CONVERSION_SIZE > size_) {
+      full_ = true;
+      return;
+    }
+    uint32_t now = micros();
+    put(TRACE_RECORD);
+    for (uint8_t i = 0; i < 4; i++, now >>= 8) put(now & 0xff);
+  }
+  else if (mode_ == replaying) {
+    begin_ = next_;
+    while (begin_ < used_ && buf_[begin_] != TRACE_RECORD) begin_ += TRACE_CONVERSION_SIZE; // skip not replayed conversions
+    if (begin_ + TRACE_RECORD_SIZE > used_) { // end of trace
+      next_ = begin_ = used_;
+      return;
+    }
+    time_ = buf_[begin_ + 1] | (uint32_t)buf_[begin_ + 2] << 8 | (uint32_t)buf_[begin_ + 3] << 16 | (uint32_t)buf_[begin_ + 4] << 24;
+    begin_ += TRACE_RECORD_SIZE;
+    next_ = begin_;
+    while (next_ < used_ && buf_[next_] != TRACE_RECORD) next_ += TRACE_CONVERSION_SIZE;
+    for (uint8_t i = 0; i < 8; i++) pos_[i] = begin_;
+  }
+}
+
+void TFT_eTouchTrace::finish()
+{
+  pending_ = false;
+  shift_bytes_ = 0;
+}
+
+uint8_t TFT_eTouchTrace::transfer(uint8_t out, SPIClass& spi)
+{
+  // same framing as the chip: the conversion of a control byte is read with the following 2 bytes
+  if (shift_bytes_ == 0 && pending_) {
+    shift_ctrl_ = pending_ctrl_;
+    shift_word_ = mode_ == replaying ? lookup(shift_ctrl_) : 0;
+    shift_bytes_ = 2;
+    pending_ = false;
+  }
+  uint8_t in = 0;
+  if (mode_ == replaying) {
+    if (shift_bytes_) {
+      in = shift_word_ >> 8;
+      shift_word_ <<= 8;
+      shift_bytes_--;
+    }
+  }
+  else {
+    in = spi.transfer(out);
+    if (shift_bytes_) {
+      shift_word_ = (shift_word_ << 8) | in;
+      if (--shift_bytes_ == 0 && mode_ == recording && !full_) {
+        if (used_ + TRACE_CONVERSION_SIZE > size_) full_ = true;
+        else {
+          put(shift_ctrl_);
+          put(shift_word_ >> 8);
+          put(shift_word_ & 0xff);
+        }
+      }
+    }
+  }
+  if (out & START_BIT) {
+    pending_ = true;
+    pending_ctrl_ = out;
+  }
+  return in;
+}
+
+void TFT_eTouchTrace::put(uint8_t val)
+{
+  buf_[used_++] = val;
+}
+
+uint16_t TFT_eTouchTrace::lookup(uint8_t ctrl)
+{
+  uint8_t channel = (ctrl >> 4) & 7;
+  uint32_t pos = pos_[channel];
+  while (pos < next_ && ((buf_[pos] >> 4) & 7) != channel) pos += TRACE_CONVERSION_SIZE;
+  if (pos < next_) {
+    uint16_t word = buf_[pos + 1] << 8 | buf_[pos + 2];
+    if (buf_[pos] & MODE_8BIT) { // 8 bit conversion, rescaled to 12 bit
+      word = (word >> 7) & 0xff;
+      word = (word << 4) | (word >> 4);
+    }
+    else {
+      word = (word >> 3) & 0x0fff;
+    }
+    last_[channel] = word;
+    pos_[channel] = pos + TRACE_CONVERSION_SIZE;
+  }
+  if (ctrl & MODE_8BIT) return (last_[channel] >> 4) << 7;
+  return last_[channel] << 3;
+}
@@ -0,0 +1,114 @@
+#ifndef TFT_E_TOUCH_TRACE_H
+#define TFT_E_TOUCH_TRACE_H
+
+//
+//  TFT_eTouchTrace.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  See TFT_eTouch/docs/html/index.html for documentation.
+//
+
+#include <Arduino.h>
+#include <SPI.h>
+
+/** 
+  * Record the conversions of the touch chip to a buffer and replay them later through the same fetch code.
+  *
+  * Every spi transaction (one fetch, or one step of an async fetch) starts a record: 0x00 and micros() as 4 bytes little endian.
+  * Each finished conversion follows as control byte (start bit set) and the 2 read bytes.
+  *
+  * On replay no spi transfer is done. The trace answers like the chip: a control byte gets the next recorded conversion of the same channel
+  * in the actual record, when there are no more, the last one of this channel is repeated. So an unchanged measure strategie
+  * get the identical input, an other strategie get the recorded values of each axis.
+@code
+static uint8_t buf[8192];
+TFT_eTouchTrace trace(buf, sizeof(buf));
+
+touch.setTrace(&trace);
+trace.record(); // touch the display, then save trace.data(), trace.used()
+...
+touch.setMeasure(...); // an other strategie
+trace.replay();
+while (!trace.end()) touch.getXY(x, y);
+@endcode
+  * @brief  touch trace
+  */
+class TFT_eTouchTrace
+{
+public:
+  typedef enum
+  {
+    off,
+    recording,
+    replaying
+  } Mode;
+
+/** 
+  * @brief  constructor
+  * @param  buf trace buffer
+  * @param  size buffer size in bytes
+  * @param  used bytes in buf of a loaded trace
+  */
+            TFT_eTouchTrace(uint8_t* buf, uint32_t size, uint32_t used = 0);
+
+  void      record(); ///< clear the trace and record the following fetches
+  void      replay(); ///< replay the trace from start
+  void      stop(); ///< stop recording or replay, the touch chip is used again
+
+  inline Mode mode() const { return mode_; }
+  inline const uint8_t* data() const { return buf_; } ///< trace data
+  inline uint32_t used() const { return used_; } ///< used bytes of trace
+  inline bool full() const { return full_; } ///< a record was dropped because the buffer was full
+  inline bool end() const { return mode_ == replaying && next_ >= used_; } ///< all records are replayed
+  inline uint32_t time() const { return time_; } ///< micros() of the actual record
+
+/** 
+  * Called by the touch when its spi transaction start.
+  * @brief  begin record
+  */
+  void      begin();
+
+/** 
+  * Called by the touch when its spi transaction end.
+  * @brief  end record
+  */
+  void      finish();
+
+/** 
+  * Exchange one byte with the touch chip or the trace.
+  * @brief  transfer
+  * @param  out byte to send
+  * @param  spi bus of touch chip, not used on replay
+  * @return received byte
+  */
+  uint8_t   transfer(uint8_t out, SPIClass& spi);
+
+private:
+  void      put(uint8_t val);
+  uint16_t  lookup(uint8_t ctrl); ///< replay word of conversion ctrl
+
+  uint8_t*  buf_;
+  uint32_t  size_;
+  uint32_t  used_;
+  Mode      mode_;
+  bool      full_;
+
+  uint32_t  time_; ///< time of actual record
+  uint32_t  begin_; ///< first conversion of actual record
+  uint32_t  next_; ///< start of next record
+  uint32_t  pos_[8]; ///< next conversion to look at for each channel
+  uint16_t  last_[8]; ///< last replayed word for each channel (12 bit)
+
+  bool      pending_; ///< control byte was sent, its conversion follows
+  uint8_t   pending_ctrl_;
+  uint8_t   shift_ctrl_; ///< control byte of the conversion shifting
+  uint8_t   shift_bytes_; ///< bytes of the conversion left
+  uint16_t  shift_word_;
+};
+
+#endif // TFT_E_TOUCH_TRACE_H
@@ -118,10 +118,121 @@ typedef TFT_eSPI TFT_Driver;
  */
 #define TOUCH_USE_DIFFERENTIAL_MEASURE
 
+/** @def TOUCH_USE_BATCH_TRANSFER
+ * If this defined is set the conversions of one fetch are send as spi block transfer instead of one transfer16() per conversion.
+ * Only used when the measure strategie has a fixed number of conversions (count > 0 and z_local_min = false), otherwise the conversational fetch is used.
+ */
+// define this to hold the spi bus shorter, costs 1 + 2 * TOUCH_BATCH_MAX_CONVERSIONS bytes of stack while fetching
+//#define TOUCH_USE_BATCH_TRANSFER
+
+/** @def TOUCH_BATCH_MAX_CONVERSIONS
+ * Maximal conversions of one block transfer. When the measure strategie needs more conversions the conversational fetch is used.
+ */
+#define TOUCH_BATCH_MAX_CONVERSIONS 40
+
+/** @def TOUCH_USE_ASYNC_UPDATE
+ * If this defined is set the member functions beginUpdate() and pollUpdate() are available. They split one fetch in short steps of one axis.
+ */
+// define this when you can't wait for a whole fetch in your loop
+//#define TOUCH_USE_ASYNC_UPDATE
+
+/** @def TOUCH_USE_SAMPLER
+ * If this defined is set the member functions startSampler(), sample() and readSample() are available.
+ * Fetches are done in a constant timeframe by a timer and stored in a lock free ring.
+ */
+// define this for fetching in background with constant rate
+//#define TOUCH_USE_SAMPLER
+
+/** @def TOUCH_SAMPLER_SIZE
+ * Number of samples the sampler ring can hold, must be a power of two.
+ */
+#define TOUCH_SAMPLER_SIZE 16
+
+/** @def TOUCH_USE_DECIMATION
+ * If this defined is set the member function setDecimation() is available.
+ * Many short fetches, spread over the measure wait, are reduced by a cascaded integrator comb decimator to one measure.
+ */
+// define this for low noise measures from a high fetch rate (e.g. with the sampler)
+//#define TOUCH_USE_DECIMATION
+
+/** @def TOUCH_DECIMATION_ORDER
+ * Integrator and comb stages of the decimator (1..3), 1 is a boxcar average. Higher orders reject more noise and need order times more fetches after pen down.
+ */
+#define TOUCH_DECIMATION_ORDER 2
+
+/** @def TOUCH_USE_TASK
+ * If this defined is set TFT_eTouch<T>::startTask() is available. (ESP32 only)
+ * A FreeRTOS task fetch, filter and transform the touch and post TFT_eTouchBase::TouchEvent to a queue.
+ */
+// define this to run touch handling on the other core
+//#define TOUCH_USE_TASK
+
+/** @def TOUCH_USE_ADAPTIVE_WAIT
+ * If this defined is set the member functions setAdaptiveWait() and getEffectiveWait() are available.
+ * The waiting time between measures follows the touch state: idle time when not touched, minimal time after pen down or move,
+ * doubled up to maximal time while the pen stay.
+ */
+// define this for less spi traffic while idle or stationary
+//#define TOUCH_USE_ADAPTIVE_WAIT
+
+/** @def TOUCH_USE_DISPLAY_SYNC
+ * If this defined is set the member functions setDisplayBusy() and frameDone() are available.
+ * While the display use the spi bus (e.g. DMA push) the touch fetch is queued and done when the bus is free.
+ */
+// define this when the display push frames with DMA on the touch spi bus
+//#define TOUCH_USE_DISPLAY_SYNC
+
+/** @def TOUCH_USE_TRACE
+ * If this defined is set the member function setTrace() is available. A TFT_eTouchTrace record the conversions of the touch chip
+ * and replay them through the same fetch, filter and transform code. @sa TFT_eTouchTrace
+ */
+// define this to tune measure strategie and filter on recorded touches
+//#define TOUCH_USE_TRACE
+
+/** @def TOUCH_USE_STATS
+ * If this defined is set the member functions stats(), resetStats() and printStats() are available.
+ * Durations of acquire (including rz), rz, filter and transform are kept in histograms (cpu cycles on ESP), with counters of conversions,
+ * out of range conversions, filter warm up drops and penirq wakeups. @sa TouchStats
+ */
+// define this to get latency percentiles of the touch stages
+//#define TOUCH_USE_STATS
+
+/** @def TOUCH_USE_PREDICTION
+ * If this defined is set the member functions predict() and setPredictionNoise() are available.
+ * A Kalman tracker per axis estimates position and velocity from getXY() / get() and predicts the position some ms ahead. @sa TouchKalman
+ */
+// define this when drawing apps trail behind the pen
+//#define TOUCH_USE_PREDICTION
+
+/** @def TOUCH_MAX_INSTANCES
+ * Number of touch instances using penirq at the same time (1..4), also the number of touch instances a TFT_eTouchBus can hold.
+ */
+#ifndef TOUCH_MAX_INSTANCES
+#define TOUCH_MAX_INSTANCES 1
+#endif
+
+/** @def TOUCH_USE_BUS
+ * If this defined is set TFT_eTouchBus is available. It fetch several touch controllers on one spi bus within one spi transaction.
+ */
+// define this when more touch controllers share one spi bus
+//#define TOUCH_USE_BUS
+
+/** @def TOUCH_MEASURE_POLICY
+ * If this defined is set the measure strategie is fixed at compile time, setMeasure() and setAveraging() are not available.
+ * Define it as MeasurePolicy with the values you would give setMeasure() and setAveraging(). @sa MeasurePolicy
+ */
+// define this to save progmem and get a fetch without strategie branches
+//#define TOUCH_MEASURE_POLICY MeasurePolicy<0, false, true, false, 3>
+
+/** @def TOUCH_SPI_CLOCK
+ * SPI clock in Hz used when the calibration has no spi clock. @sa TFT_eTouchBase::tuneSPIClock()
+ */
+#define TOUCH_SPI_CLOCK 2000000
+
 /** @def TOUCH_DEFAULT_CALIBRATION
  * This is the used touch configuration. If it's match to your configuration, you can disable TOUCH_USE_USER_CALIBRATION.
  */
-#define TOUCH_DEFAULT_CALIBRATION { 272, 3749, 3894, 341, 0 }
+#define TOUCH_DEFAULT_CALIBRATION { 272, 3749, 3894, 341, 0, 0 }
 
 /** @def TOUCH_FILTER_TYPE
  * If this defined is set the touch driver filter raw data with a fir filter,
@@ -130,6 +241,11 @@ typedef TFT_eSPI TFT_Driver;
  * - 1: Hamming
  * - 2: Hanning
  * - 3: Blackmann
+ * - 4: OneEuroFilter for x and y, smoothing adapt to the pen speed, see TFT_eTouchBase::setAdaptiveFilter() (a given TOUCH_X_FILTER must have setParameter())
+ *
+ * Instead of a FirFilter a MedianFilter or HampelFilter (spike rejection) can be used for a value, the window type is ignored by them.
+ * Stages can be combined with FilterChain, e.g. FilterChain<HampelFilter<7>, FirFilter<12>, Deadband<2> >.
+ * TOUCH_X_FILTER and TOUCH_Y_FILTER are only set here when they are not given to the compiler.
  */
 //#define TOUCH_FILTER_TYPE 1
 
@@ -144,31 +260,76 @@ typedef TFT_eSPI TFT_Driver;
 // define this to see additional output on Serial
 #define TOUCH_SERIAL_DEBUG
 
-/** @def TOUCH_SERIAL_CONVERSATION_TIME
- * If this defined is set the library show time of one conversation in microsecond to Serial.
- * When TOUCH_SERIAL_DEBUG_FETCH is defined you got additional time from the print call!
- * When defined, getUserCalibration() won't work.
- */
-// define this to see converation time on Serial for fetching raw values
-//#define TOUCH_SERIAL_CONVERSATION_TIME
-
 /** @def TOUCH_SERIAL_DEBUG_FETCH
  * If this defined is set the library show ctrl command of invalid read measure to Serial.
  */
 // define this to see if X, Y, Z1 or Z2 measure is out of range when not touched
 //#define TOUCH_SERIAL_DEBUG_FETCH
 
+/** @def TOUCH_USE_LOG
+ * If this defined is set the output of TOUCH_SERIAL_DEBUG and TOUCH_SERIAL_DEBUG_FETCH from update, fetch, filter and penirq
+ * is stored as binary record in touch_log instead of printed. Call touch_log.flush(Serial) from loop() to print them. @sa TouchLog
+ */
+// define this when Serial output disturbs the timing of the measure
+//#define TOUCH_USE_LOG
+
+/** @def TOUCH_LOG_SIZE
+ * Number of records touch_log hold, must be a power of two up to 128. When flush() is called too rarely the oldest records are dropped.
+ */
+#define TOUCH_LOG_SIZE 32
+
 
 #ifdef TOUCH_FILTER_TYPE
 #include <TFT_eFirFilter.h>
+#include <TFT_eMedianFilter.h>
+#include <TFT_eFilterChain.h>
+# if TOUCH_FILTER_TYPE == 4
+#include <TFT_eOneEuroFilter.h>
+#define TOUCH_ADAPTIVE_FILTER
+#   ifndef TOUCH_X_FILTER
+#define TOUCH_X_FILTER OneEuroFilter<>
+#   endif
+# elif !defined(TOUCH_X_FILTER)
 // undefine a filter or change N, N must be even (default 12), T must be uint16_t whitch is default
+// e.g. HampelFilter<7> remove spikes of noisy panels without delay, MedianFilter<5> also smooth
+// or compose stages: FilterChain<HampelFilter<7>, FirFilter<12>, Deadband<2> >
+// (a product can also pass -DTOUCH_X_FILTER=... to the compiler)
 #define TOUCH_X_FILTER FirFilter<20>
+# endif
+# ifndef TOUCH_Y_FILTER
 #define TOUCH_Y_FILTER TOUCH_X_FILTER
+# endif
 //#define TOUCH_Z_FILTER FirFilter<>
+// true: the first touched value fill the filter, the touch is reported without waiting N measures (filter reset when released)
+#define TOUCH_FILTER_WARM_START false
+// or filter x, y (and z1, z2 when Lanes is 4) in one pass, the filters above are not used then
+//#define TOUCH_FILTER_BANK FirFilterBank<20, 4>
+# ifdef TOUCH_FILTER_BANK
+#undef TOUCH_X_FILTER
+#undef TOUCH_Y_FILTER
+#undef TOUCH_Z_FILTER
+# endif
 #endif
 
 #ifndef TOUCH_DEFAULT_CALIBRATION
-#define TOUCH_DEFAULT_CALIBRATION { 300, 3700, 300, 3700, 2 }
+#define TOUCH_DEFAULT_CALIBRATION { 300, 3700, 300, 3700, 2, 0 }
+#endif
+
+#ifndef TOUCH_SPI_CLOCK
+#define TOUCH_SPI_CLOCK 2000000
+#endif
+
+#ifndef TOUCH_MAX_INSTANCES
+#define TOUCH_MAX_INSTANCES 1
+#endif
+
+#if defined (TOUCH_FILTER_TYPE) && !defined (TOUCH_FILTER_WARM_START)
+#define TOUCH_FILTER_WARM_START false
+#endif
+
+#ifdef TOUCH_SERIAL_CONVERSATION_TIME
+// replaced by TOUCH_USE_STATS, see printStats()
+#define TOUCH_USE_STATS
 #endif
 
 #if defined (_ILI9341_t3H_) || defined (_ADAFRUIT_ILI9341H_)
@@ -194,11 +355,23 @@ typedef TFT_eSPI TFT_Driver;
 #define TOUCH_USE_SIMPE_TARGET
 #define TOUCH_USE_GESTURE
 #define TOUCH_USE_DIFFERENTIAL_MEASURE
+#define TOUCH_USE_BATCH_TRANSFER
+#define TOUCH_USE_ASYNC_UPDATE
+#define TOUCH_USE_SAMPLER
+#define TOUCH_USE_DECIMATION
+#define TOUCH_USE_TASK
+#define TOUCH_USE_ADAPTIVE_WAIT
+#define TOUCH_USE_BUS
+#define TOUCH_USE_DISPLAY_SYNC
+#define TOUCH_USE_TRACE
+#define TOUCH_USE_STATS
+#define TOUCH_USE_LOG
+#define TOUCH_USE_PREDICTION
 #define BASIC_FONT_SUPPORT
 #define TOUCH_SERIAL_DEBUG
-#define TOUCH_SERIAL_CONVERSATION_TIME
 #define TOUCH_SERIAL_DEBUG_FETCH
 #define TOUCH_FILTER_TYPE 1
+#define TOUCH_ADAPTIVE_FILTER
 #endif
 
 #endif // TFT_E_TOUCH_USER_H
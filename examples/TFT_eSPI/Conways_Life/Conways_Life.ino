@@ -802,7 +802,7 @@ void setup()
     touch.writeCalibration(CALIBRATION_FILE);
 #else
     Serial.printf("Calibration not readed %s take default configuration. Store a valid configuration with eTouch_edit\n", CALIBRATION_FILE);
-    touch.calibration() = { 265, 3790, 264, 3850, 2 };
+    touch.calibration() = { 265, 3790, 264, 3850, 2, 0 };
 #endif
   }
 #endif
@@ -191,7 +191,7 @@ acurate on point[4, 4](334, 400) dx: 204 dy: 11 > 10 nok
   touch.setRZThreshold(1000);
 
 #ifndef DEFAULT_CALIBRATION
-  TFT_eTouchBase::Calibation calibation = { 265, 3790, 264, 3850, 2 }; // x and y axes have same direction on touch & display
+  TFT_eTouchBase::Calibation calibation = { 265, 3790, 264, 3850, 2, 0 }; // x and y axes have same direction on touch & display
 //  TFT_eTouchBase::Calibation calibation = { 3790, 265, 3850, 264, 0 }; // same as above
 //  TFT_eTouchBase::Calibation calibation = { 272, 3749, 3894, 341, 0 }; // y axes have oposite direction
 
@@ -164,6 +164,7 @@ void loop(void) {
   if (touch.getXY(x, y)) {
     menue.update(x, y, touch.getRZ());
 #endif
+    touch.invalidateTransform(); // the menu counters change calibration() values
     if (!was_touched) {
       was_touched = true;
       Serial.println("pen down");
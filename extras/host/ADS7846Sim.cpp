@@ -0,0 +1,143 @@
+//
+//  ADS7846Sim.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+
+#include "ADS7846Sim.h"
+
+// channel select A2..A0 of the control byte
+#define CHANNEL_Y  1
+#define CHANNEL_Z1 3
+#define CHANNEL_Z2 4
+#define CHANNEL_X  5
+
+#define START_BIT  0x80
+#define MODE_8BIT  0x08
+#define PD_MASK    0x03 // PD1 PD0, 00 is power down between conversions with penirq enabled
+
+ADS7846Sim::ADS7846Sim(uint32_t seed)
+: touched_(false)
+, x_(0), y_(0), z1_(0), z2_(0)
+, seed_(seed ? seed : 1)
+, conversions_(0)
+, last_channel_(0)
+, same_channel_(0)
+, last_value_(0)
+, out_(0)
+, out_bytes_(0)
+, pending_(false)
+, pending_value_(0)
+, last_ctrl_(0)
+, powered_deselects_(0)
+{
+}
+
+void ADS7846Sim::touch(uint16_t x, uint16_t y, uint16_t rz)
+{
+  touched_ = true;
+  x_ = x;
+  y_ = y;
+  // R_TOUCH = Rx-plate * X/4096 * (Z2/Z1 - 1)
+  float ratio = 1.0f + (float)rz * 4096.0f / ((float)panel_.rx_plate * (x ? x : 1));
+  z2_ = 3800;
+  z1_ = (uint16_t)(z2_ / ratio + 0.5f);
+}
+
+void ADS7846Sim::release()
+{
+  touched_ = false;
+}
+
+void ADS7846Sim::select(bool active)
+{
+  if (active) { // new frame, nothing to shift out
+    out_bytes_ = 0;
+    pending_ = false;
+  }
+  else if (last_ctrl_ & PD_MASK) {
+    powered_deselects_++;
+  }
+}
+
+uint8_t ADS7846Sim::transfer(uint8_t out)
+{
+  if (out_bytes_ == 0 && pending_) {
+    out_ = pending_value_;
+    out_bytes_ = 2;
+    pending_ = false;
+  }
+  uint8_t in = 0;
+  if (out_bytes_) {
+    in = out_ >> 8;
+    out_ <<= 8;
+    out_bytes_--;
+  }
+  if (out & START_BIT) {
+    last_ctrl_ = out;
+    pending_ = true;
+    pending_value_ = convert(out);
+  }
+  return in;
+}
+
+uint32_t ADS7846Sim::random()
+{
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  return seed_;
+}
+
+float ADS7846Sim::gauss()
+{
+  // sum of 4 uniform [-0.5, 0.5) has variance 1/3
+  float sum = 0;
+  for (uint8_t i = 0; i < 4; i++) sum += (random() & 0xffff) / 65536.0f - 0.5f;
+  return sum * 1.7320508f;
+}
+
+uint16_t ADS7846Sim::ideal(uint8_t channel) const
+{
+  if (!touched_) { // plates open, X and Y float to full scale
+    return channel == CHANNEL_Z1 ? 0 : 4095;
+  }
+  switch (channel) {
+    case CHANNEL_X:  return x_;
+    case CHANNEL_Y:  return y_;
+    case CHANNEL_Z1: return z1_;
+    case CHANNEL_Z2: return z2_;
+  }
+  return 0; // temperature, battery and aux are not simulated
+}
+
+uint16_t ADS7846Sim::convert(uint8_t ctrl)
+{
+  conversions_++;
+  uint8_t channel = (ctrl >> 4) & 7;
+  float v = ideal(channel);
+
+  if (channel != last_channel_) {
+    last_channel_ = channel;
+    same_channel_ = 0;
+  }
+  else if (same_channel_ < 31) {
+    same_channel_++;
+  }
+  if (panel_.settling > 0) {
+    v += (last_value_ - v) * panel_.settling / (float)(1u << same_channel_);
+  }
+  float noise = panel_.noise * gauss();
+  if (panel_.spike > 0 && (random() & 0xffff) < (uint32_t)(panel_.spike * 65536.0f)) noise *= 40;
+  v += noise;
+  last_value_ = v;
+
+  int32_t value = (int32_t)(v + 0.5f);
+  if (value < 0) value = 0;
+  if (value > 4095) value = 4095;
+  if (ctrl & MODE_8BIT) return (uint16_t)((value >> 4) << 7);
+  return (uint16_t)(value << 3);
+}
@@ -0,0 +1,74 @@
+#ifndef ADS7846_SIM_H
+#define ADS7846_SIM_H
+
+//
+//  ADS7846Sim.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+
+#include <SPI.h>
+
+/** 
+  * Simulated ADS7846 / XPT2046 on the host spi bus.
+  * A control byte (start bit set) starts a conversion of X, Y, Z1 or Z2 (12 or 8 bit),
+  * the result is clocked out in the following two bytes, as the chip does with 16 clocks per conversion.
+  * @brief  simulated touch controller
+  */
+class ADS7846Sim : public SPIDevice
+{
+public:
+  struct Panel
+  {
+    uint16_t rx_plate;  ///< resistance of X-plate in ohm
+    float    noise;     ///< standard deviation of each conversion in LSB
+    float    settling;  ///< part of the previous channel value left in the first conversion after a channel switch, halved on each further conversion
+    float    spike;     ///< probability of a spike (noise * 40) per conversion
+    Panel() : rx_plate(300), noise(4), settling(0), spike(0) {}
+  };
+
+          ADS7846Sim(uint32_t seed = 1);
+
+  void    touch(uint16_t x, uint16_t y, uint16_t rz = 300); ///< pen down at raw x, y with touch resistance rz in ohm
+  void    release(); ///< pen up
+  bool    touched() const { return touched_; }
+
+  Panel&  panel() { return panel_; }
+  void    seed(uint32_t seed) { seed_ = seed ? seed : 1; }
+
+  uint32_t conversions() const { return conversions_; } ///< started conversions
+  uint32_t poweredDeselects() const { return powered_deselects_; } ///< chip deselected while last control byte left the ADC on (PD not 00), penirq is then disabled
+  void    select(bool active);
+  uint8_t transfer(uint8_t out);
+
+private:
+  uint32_t random(); ///< xorshift32
+  float   gauss(); ///< approximated normal distribution
+  uint16_t ideal(uint8_t channel) const; ///< noiseless 12 bit value of channel
+  uint16_t convert(uint8_t ctrl);
+
+  Panel   panel_;
+  bool    touched_;
+  uint16_t x_;
+  uint16_t y_;
+  uint16_t z1_;
+  uint16_t z2_;
+
+  uint32_t seed_;
+  uint32_t conversions_;
+  uint8_t last_channel_; ///< channel of previous conversion
+  uint8_t same_channel_; ///< conversions on last_channel_ since switch
+  float   last_value_; ///< value of previous conversion
+
+  uint16_t out_; ///< result shifting out
+  uint8_t out_bytes_; ///< bytes of out_ left
+  bool    pending_; ///< conversion started by last control byte
+  uint16_t pending_value_;
+  uint8_t last_ctrl_; ///< last control byte
+  uint32_t powered_deselects_;
+};
+
+#endif // ADS7846_SIM_H
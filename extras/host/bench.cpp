@@ -0,0 +1,307 @@
+//
+//  bench.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  Run the touch library against the simulated ADS7846 on the host.
+//  usage: tft_etouch_bench [samples] [noise] [settling] [spike]
+//
+//  For every stage the wall clock time per sample and a checksum of the results are shown.
+//  The checksum only changes when the results change, compare it before and after a change.
+//
+
+#include <TFT_eTouch.h>
+#include <TFT_eFirFilter.h>
+#include <TFT_eMedianFilter.h>
+#include <TFT_eFilterChain.h>
+#include <TFT_eTouchDecimator.h>
+#include <TFT_eOneEuroFilter.h>
+#include <TFT_eTouchGesture.h>
+#include "ADS7846Sim.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+static TFT_eSPI tft;
+static TFT_eTouch<TFT_eSPI> touch(tft, TFT_ETOUCH_CS);
+static ADS7846Sim sim;
+
+class Checksum
+{
+public:
+  Checksum() : h_(2166136261u) {}
+  void add(uint32_t v) { for (uint8_t i = 0; i < 4; i++) { h_ = (h_ ^ (v & 0xff)) * 16777619u; v >>= 8; } }
+  uint32_t value() const { return h_; }
+private:
+  uint32_t h_;
+};
+
+class Stage
+{
+public:
+  Stage(const char* name, uint32_t samples)
+  : name_(name)
+  , samples_(samples)
+  , bytes_(SPI.bytes())
+  , conversions_(sim.conversions())
+  , powered_(sim.poweredDeselects())
+  , sim_ns_(hostNanos())
+  , start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  void done(const Checksum& sum)
+  {
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+    printf("%-10s %9u samples %8.1f ns/sample %7.2f M/s  checksum %08x", name_, samples_, ns / samples_, samples_ * 1000.0 / ns, sum.value());
+    if (SPI.bytes() != bytes_) {
+      printf("  spi %.1f bytes %.1f conv %.1f us", (double)(SPI.bytes() - bytes_) / samples_,
+        (double)(sim.conversions() - conversions_) / samples_, (hostNanos() - sim_ns_) / 1000.0 / samples_);
+    }
+    printf("\n");
+    if (sim.poweredDeselects() != powered_) { // a fetch (e.g. a failed batch) did not end with power down, penirq would stay off
+      printf("%s: %u fetches left the adc on\n", name_, sim.poweredDeselects() - powered_);
+    }
+  }
+
+private:
+  const char* name_;
+  uint32_t samples_;
+  uint32_t bytes_;
+  uint32_t conversions_;
+  uint32_t powered_;
+  uint64_t sim_ns_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// pen position on a circle, released for 1/8 of each turn
+static bool stroke(uint32_t i)
+{
+  uint16_t a = i & 0x3ff;
+  if (a >= 0x380) {
+    sim.release();
+    return false;
+  }
+  float rad = a * (2 * PI / 1024);
+  sim.touch((uint16_t)(2048 + 1400 * cos(rad)), (uint16_t)(2048 + 1400 * sin(rad)), 250 + (a & 0x3f));
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t samples = argc > 1 ? strtoul(argv[1], 0, 0) : 1000000;
+  if (argc > 2) sim.panel().noise = (float)atof(argv[2]);
+  if (argc > 3) sim.panel().settling = (float)atof(argv[3]);
+  if (argc > 4) sim.panel().spike = (float)atof(argv[4]);
+  if (samples == 0) samples = 1;
+
+  SPI.attach(sim, TFT_ETOUCH_CS);
+  touch.init();
+  touch.setMeasureWait(0);
+
+  { // fetch raw values
+    Checksum sum;
+    Stage stage("fetch", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      stroke(i);
+      TFT_eTouchBase::Measure raw;
+      if (touch.getRaw(raw)) {
+        sum.add(raw.x | (uint32_t)raw.y << 16);
+        sum.add(raw.rz);
+      }
+    }
+    stage.done(sum);
+  }
+
+  { // fetch, filter and transform
+    touch.reset();
+    Checksum sum;
+    Stage stage("getXY", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      stroke(i);
+      int16_t x, y;
+      if (touch.getXY(x, y)) sum.add((uint16_t)x | (uint32_t)(uint16_t)y << 16);
+    }
+    stage.done(sum);
+  }
+
+#if defined (TOUCH_USE_AVERAGING_CODE) && !defined (TOUCH_MEASURE_POLICY)
+  { // fetch with averaging, a release is first seen after all conversions of the first axis
+    touch.setAveraging(true);
+    Checksum sum;
+    Stage stage("average", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      stroke(i);
+      TFT_eTouchBase::Measure raw;
+      if (touch.getRaw(raw)) {
+        sum.add(raw.x | (uint32_t)raw.y << 16);
+        sum.add(raw.rz);
+      }
+    }
+    stage.done(sum);
+    touch.setAveraging(false);
+  }
+#endif // end TOUCH_USE_AVERAGING_CODE && !TOUCH_MEASURE_POLICY
+
+#ifdef TOUCH_USE_TRACE
+  { // replay a recorded trace, must give the checksum of the recording
+    uint32_t fetches = samples < 100000 ? samples : 100000;
+    static uint8_t buf[100000 * 48];
+    TFT_eTouchTrace trace(buf, sizeof(buf));
+    touch.setTrace(&trace);
+    Checksum rec_sum;
+    trace.record();
+    for (uint32_t i = 0; i < fetches; i++) {
+      stroke(i);
+      TFT_eTouchBase::Measure raw;
+      if (touch.getRaw(raw)) rec_sum.add(raw.x | (uint32_t)raw.y << 16);
+    }
+    Checksum sum;
+    Stage stage("replay", fetches);
+    trace.replay();
+    for (uint32_t i = 0; i < fetches; i++) {
+      TFT_eTouchBase::Measure raw;
+      if (touch.getRaw(raw)) sum.add(raw.x | (uint32_t)raw.y << 16);
+    }
+    stage.done(sum);
+    if (sum.value() != rec_sum.value() || trace.full()) printf("replay differs from recording %08x\n", rec_sum.value());
+    touch.setTrace(0);
+  }
+#endif // end TOUCH_USE_TRACE
+
+  // recorded measures for the stages without spi
+  const uint16_t recorded = 1024;
+  static TFT_eTouchBase::Measure raws[recorded];
+  sim.seed(2);
+  touch.reset();
+  for (uint16_t i = 0; i < recorded; i++) {
+    stroke(i);
+    if (!touch.getRaw(raws[i])) raws[i].rz = 0xffff;
+  }
+
+  { // transform only
+    Checksum sum;
+    Stage stage("transform", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      TFT_eTouchBase::TouchPoint tp;
+      if (touch.transform(raws[i & (recorded - 1)], tp)) sum.add((uint16_t)tp.x | (uint32_t)(uint16_t)tp.y << 16);
+    }
+    stage.done(sum);
+  }
+
+  { // fir filter only
+    FirFilter<20> filter(1);
+    Checksum sum;
+    Stage stage("fir", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      sum.add(filter.next(raws[i & (recorded - 1)].x));
+    }
+    stage.done(sum);
+  }
+
+  { // median filter only
+    MedianFilter<5> filter;
+    Checksum sum;
+    Stage stage("median", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      sum.add(filter.next(raws[i & (recorded - 1)].x));
+    }
+    stage.done(sum);
+  }
+
+  { // hampel filter only
+    HampelFilter<7> filter;
+    Checksum sum;
+    Stage stage("hampel", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      sum.add(filter.next(raws[i & (recorded - 1)].x));
+    }
+    stage.done(sum);
+  }
+
+  { // spike rejection, smoothing and deadband in one pipeline
+    FilterChain<HampelFilter<7>, FirFilter<12>, Deadband<2> > filter;
+    Checksum sum;
+    Stage stage("chain", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      sum.add(filter.next(raws[i & (recorded - 1)].x));
+    }
+    stage.done(sum);
+  }
+
+  { // speed adaptive filter only, the clock does not run here so dt is the minimum
+    OneEuroFilter<> filter;
+    Checksum sum;
+    Stage stage("oneeuro", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      sum.add(filter.next(raws[i & (recorded - 1)].x));
+    }
+    stage.done(sum);
+  }
+
+  { // four fir filter for x, y, z1, z2
+    FirFilter<20> filter[4];
+    Checksum sum;
+    Stage stage("fir4", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      const TFT_eTouchBase::Measure& raw = raws[i & (recorded - 1)];
+      uint16_t x = filter[0].next(raw.x), y = filter[1].next(raw.y);
+      uint16_t z1 = filter[2].next(raw.z1), z2 = filter[3].next(raw.z2);
+      sum.add(x | (uint32_t)y << 16);
+      sum.add(z1 | (uint32_t)z2 << 16);
+    }
+    stage.done(sum);
+  }
+
+  { // the same in one filter bank, must give the checksum of fir4
+    FirFilterBank<20, 4> bank(1);
+    Checksum sum;
+    Stage stage("bank", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      const TFT_eTouchBase::Measure& raw = raws[i & (recorded - 1)];
+      uint16_t lane[4] = { raw.x, raw.y, raw.z1, raw.z2 };
+      if (!bank.next(lane)) lane[0] = lane[1] = lane[2] = lane[3] = 0;
+      sum.add(lane[0] | (uint32_t)lane[1] << 16);
+      sum.add(lane[2] | (uint32_t)lane[3] << 16);
+    }
+    stage.done(sum);
+  }
+
+  { // x, y, z1, z2 decimated by 16, time per input sample
+    TouchDecimator<4, 2> decimator;
+    decimator.setRatio(16);
+    Checksum sum;
+    Stage stage("decimate", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      const TFT_eTouchBase::Measure& raw = raws[i & (recorded - 1)];
+      uint16_t value[4] = { raw.x, raw.y, raw.z1, raw.z2 };
+      if (!decimator.add(value, value)) continue;
+      sum.add(value[0] | (uint32_t)value[1] << 16);
+      sum.add(value[2] | (uint32_t)value[3] << 16);
+    }
+    stage.done(sum);
+  }
+
+  { // gesture
+    TFT_eTouchGesture gesture(32);
+    Checksum sum;
+    Stage stage("gesture", samples);
+    for (uint32_t i = 0; i < samples; i++) {
+      const TFT_eTouchBase::Measure& raw = raws[i & (recorded - 1)];
+      if (raw.rz == 0xffff) {
+        gesture.reset();
+        continue;
+      }
+      gesture.set(raw);
+      int16_t angle = 0;
+      sum.add(gesture.get(angle) | (uint32_t)(uint16_t)angle << 16);
+    }
+    stage.done(sum);
+  }
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+//
+//  replay.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  Replay a trace recorded with TFT_eTouchTrace on a board through the fetch and transform code.
+//  usage: tft_etouch_replay trace.bin [drop z_once z_first z_local_min count [averaging ignore_min_max]]
+//
+//  Prints one line per touched fetch: time, raw x, y, z1, z2, rz and display x, y.
+//
+
+#include <TFT_eTouch.h>
+
+#include <stdlib.h>
+
+static TFT_eSPI tft;
+static TFT_eTouch<TFT_eSPI> touch(tft, TFT_ETOUCH_CS);
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace.bin [drop z_once z_first z_local_min count [averaging ignore_min_max]]\n", argv[0]);
+    return 1;
+  }
+  FILE* f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t* buf = (uint8_t*)malloc(size > 0 ? size : 1);
+  size_t used = buf ? fread(buf, 1, size, f) : 0;
+  fclose(f);
+
+  touch.init();
+  touch.setMeasureWait(0);
+  if (argc >= 7) {
+    touch.setMeasure(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+  }
+#ifdef TOUCH_USE_AVERAGING_CODE
+  if (argc >= 9) {
+    touch.setAveraging(atoi(argv[7]), atoi(argv[8]));
+  }
+#endif
+
+  TFT_eTouchTrace trace(buf, used, used);
+  touch.setTrace(&trace);
+  trace.replay();
+  uint32_t fetches = 0;
+  while (!trace.end()) {
+    TFT_eTouchBase::Measure raw;
+    fetches++;
+    if (touch.getRaw(raw)) {
+      TFT_eTouchBase::TouchPoint tp;
+      touch.transform(raw, tp);
+      printf("%lu %u %u %u %u %u %d %d\n", (unsigned long)trace.time(), raw.x, raw.y, raw.z1, raw.z2, raw.rz, tp.x, tp.y);
+    }
+  }
+  fprintf(stderr, "%lu fetches replayed\n", (unsigned long)fetches);
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,129 @@
+//
+//  Arduino.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdarg.h>
+
+HardwareSerial Serial;
+
+static uint64_t host_ns = 0;
+static uint8_t pin_state[256];
+static void (*irq_fnk[256])();
+
+uint32_t micros()
+{
+  return (uint32_t)(host_ns / 1000);
+}
+
+uint32_t millis()
+{
+  return (uint32_t)(host_ns / 1000000);
+}
+
+void delay(uint32_t ms)
+{
+  host_ns += (uint64_t)ms * 1000000;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  host_ns += (uint64_t)us * 1000;
+}
+
+void hostAdvance(uint32_t ns)
+{
+  host_ns += ns;
+}
+
+uint64_t hostNanos()
+{
+  return host_ns;
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  pin_state[pin] = val;
+  SPIClass::pinChanged(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin_state[pin];
+}
+
+void attachInterrupt(int irq, void (*fnk)(), int)
+{
+  irq_fnk[irq & 0xff] = fnk;
+}
+
+void detachInterrupt(int irq)
+{
+  irq_fnk[irq & 0xff] = 0;
+}
+
+void hostInterrupt(int irq)
+{
+  if (irq_fnk[irq & 0xff]) irq_fnk[irq & 0xff]();
+}
+
+size_t Print::print(const char* s)
+{
+  return enabled_ ? fputs(s, stdout), strlen(s) : 0;
+}
+
+size_t Print::print(char c)
+{
+  return enabled_ ? (putchar(c), 1) : 0;
+}
+
+size_t Print::print(long val, int base)
+{
+  if (base == DEC) return printf("%ld", val);
+  return print((unsigned long)val, base);
+}
+
+size_t Print::print(unsigned long val, int base)
+{
+  if (!enabled_) return 0;
+  if (base == DEC) return printf("%lu", val);
+  if (base == HEX) return printf("%lX", val);
+  char buf[8 * sizeof(val) + 1];
+  char* p = buf + sizeof(buf) - 1;
+  *p = 0;
+  do {
+    *--p = "0123456789ABCDEF"[val % base];
+    val /= base;
+  } while (val);
+  return print(p);
+}
+
+size_t Print::print(double val, int digits)
+{
+  return printf("%.*f", digits, val);
+}
+
+size_t Print::printf(const char* fmt, ...)
+{
+  if (!enabled_) return 0;
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n > 0 ? n : 0;
+}
+
+size_t Print::write(const uint8_t* buf, size_t size)
+{
+  return enabled_ ? fwrite(buf, 1, size, stdout) : 0;
+}
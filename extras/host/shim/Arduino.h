@@ -0,0 +1,100 @@
+#ifndef TFT_E_TOUCH_HOST_ARDUINO_H
+#define TFT_E_TOUCH_HOST_ARDUINO_H
+
+//
+//  Arduino.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  Minimal Arduino core for building TFT_eTouch on a host (Linux, macOS).
+//  Time is simulated: it only moves on delay(), delayMicroseconds(), spi transfers and hostAdvance().
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define HOST_BUILD
+#define ARDUINO 10800
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+#define FALLING 2
+
+#define BIN 2
+#define OCT 8
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+uint32_t micros();
+uint32_t millis();
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+
+void     hostAdvance(uint32_t ns); ///< move simulated time forward
+uint64_t hostNanos(); ///< simulated time in nanoseconds
+
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t val);
+int      digitalRead(uint8_t pin);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void     attachInterrupt(int irq, void (*fnk)(), int mode);
+void     detachInterrupt(int irq);
+void     hostInterrupt(int irq); ///< call the attached interrupt function
+
+/** 
+  * Print to stdout, only the functions used by the library.
+  * operator bool() is false until begin() is called, so the library keep quiet by default.
+  */
+class Print
+{
+public:
+  Print() : enabled_(false) {}
+
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(long val, int base = DEC);
+  size_t print(unsigned long val, int base = DEC);
+  size_t print(int val, int base = DEC) { return print((long)val, base); }
+  size_t print(unsigned int val, int base = DEC) { return print((unsigned long)val, base); }
+  size_t print(double val, int digits = 2);
+  size_t println() { return print('\n'); }
+  template <class V> size_t println(V val) { size_t n = print(val); return n + println(); }
+  template <class V> size_t println(V val, int fmt) { size_t n = print(val, fmt); return n + println(); }
+  size_t printf(const char* fmt, ...);
+  size_t write(const uint8_t* buf, size_t size);
+
+  explicit operator bool() const { return enabled_; }
+
+protected:
+  bool enabled_;
+};
+
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long) { enabled_ = true; }
+  void end() { enabled_ = false; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // TFT_E_TOUCH_HOST_ARDUINO_H
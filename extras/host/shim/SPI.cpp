@@ -0,0 +1,82 @@
+//
+//  SPI.cpp
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+
+#include <SPI.h>
+
+SPIClass SPI;
+
+SPIClass* SPIClass::buses_[SPI_MAX_DEVICES];
+
+SPIClass::SPIClass()
+: size_(0)
+, selected_(0)
+, clock_(4000000)
+, transactions_(0)
+, bytes_(0)
+{
+}
+
+void SPIClass::beginTransaction(const SPISettings& settings)
+{
+  clock_ = settings.clock_ ? settings.clock_ : 1;
+  transactions_++;
+}
+
+void SPIClass::endTransaction()
+{
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  hostAdvance((uint32_t)(8000000000ull / clock_));
+  bytes_++;
+  return selected_ ? selected_->transfer(data) : 0xff;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+  uint16_t hi = transfer(data >> 8);
+  return (hi << 8) | transfer(data & 0xff);
+}
+
+void SPIClass::transfer(void* buf, size_t count)
+{
+  uint8_t* p = (uint8_t*)buf;
+  for (size_t i = 0; i < count; i++) p[i] = transfer(p[i]);
+}
+
+bool SPIClass::attach(SPIDevice& dev, uint8_t cs_pin)
+{
+  if (size_ >= SPI_MAX_DEVICES) return false;
+  slot_[size_].dev = &dev;
+  slot_[size_].cs = cs_pin;
+  size_++;
+  for (uint8_t i = 0; i < SPI_MAX_DEVICES; i++) {
+    if (buses_[i] == this) break;
+    if (!buses_[i]) {
+      buses_[i] = this;
+      break;
+    }
+  }
+  return true;
+}
+
+void SPIClass::pinChanged(uint8_t pin, uint8_t val)
+{
+  for (uint8_t b = 0; b < SPI_MAX_DEVICES && buses_[b]; b++) {
+    SPIClass* bus = buses_[b];
+    for (uint8_t i = 0; i < bus->size_; i++) {
+      if (bus->slot_[i].cs != pin) continue;
+      SPIDevice* dev = bus->slot_[i].dev;
+      dev->select(val == LOW);
+      if (val == LOW) bus->selected_ = dev;
+      else if (bus->selected_ == dev) bus->selected_ = 0;
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef TFT_E_TOUCH_HOST_SPI_H
+#define TFT_E_TOUCH_HOST_SPI_H
+
+//
+//  SPI.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  Host SPI bus: transfers go to the SPIDevice whose chip select is low.
+//  Every byte moves the simulated time by 8 clocks of the transaction clock.
+//
+
+#include <Arduino.h>
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+#define SPI_MAX_DEVICES 4
+
+class SPISettings
+{
+public:
+  SPISettings(uint32_t clock = 4000000, uint8_t bit_order = MSBFIRST, uint8_t data_mode = SPI_MODE0)
+  : clock_(clock)
+  {
+    (void)bit_order; (void)data_mode;
+  }
+  uint32_t clock_;
+};
+
+/** 
+  * Device on the host spi bus, e.g. a simulated touch controller.
+  */
+class SPIDevice
+{
+public:
+  virtual         ~SPIDevice() {}
+  virtual void    select(bool active) { (void)active; } ///< chip select changed, active when low
+  virtual uint8_t transfer(uint8_t out) = 0; ///< exchange one byte
+};
+
+class SPIClass
+{
+public:
+  SPIClass();
+
+  void      begin() {}
+  void      begin(int8_t, int8_t, int8_t, int8_t) {}
+  void      end() {}
+
+  void      beginTransaction(const SPISettings& settings);
+  void      endTransaction();
+
+  uint8_t   transfer(uint8_t data);
+  uint16_t  transfer16(uint16_t data);
+  void      transfer(void* buf, size_t count);
+
+/** 
+  * @brief  connect device
+  * @param  dev device answering while cs_pin is low
+  * @param  cs_pin chip select of the device
+  * @return false when SPI_MAX_DEVICES are attached
+  */
+  bool      attach(SPIDevice& dev, uint8_t cs_pin);
+
+  uint32_t  clock() const { return clock_; } ///< clock of the last transaction
+  uint32_t  transactions() const { return transactions_; } ///< number of beginTransaction() calls
+  uint32_t  bytes() const { return bytes_; } ///< number of transfered bytes
+
+  static void pinChanged(uint8_t pin, uint8_t val); ///< called by digitalWrite()
+
+private:
+  struct Slot
+  {
+    SPIDevice* dev;
+    uint8_t    cs;
+  };
+
+  static SPIClass* buses_[SPI_MAX_DEVICES];
+
+  Slot      slot_[SPI_MAX_DEVICES];
+  uint8_t   size_;
+  SPIDevice* selected_;
+  uint32_t  clock_;
+  uint32_t  transactions_;
+  uint32_t  bytes_;
+};
+
+extern SPIClass SPI;
+
+#endif // TFT_E_TOUCH_HOST_SPI_H
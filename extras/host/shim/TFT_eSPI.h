@@ -0,0 +1,60 @@
+#ifndef TFT_E_TOUCH_HOST_TFT_ESPI_H
+#define TFT_E_TOUCH_HOST_TFT_ESPI_H
+
+//
+//  TFT_eSPI.h
+//
+//  (C) Copyright Achill Hasler 2019.
+//
+//  Distributed under the Boost Software License, Version 1.0.
+//  See accompanying file at https://www.boost.org/LICENSE_1_0.txt
+//
+//
+//  Headless 240x320 display with the TFT_eSPI functions used by TFT_eTouch<T>, nothing is drawn.
+//
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define TFT_BLACK 0x0000
+#define TFT_BLUE  0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_RED   0xF800
+#define TFT_WHITE 0xFFFF
+
+class TFT_eSPI : public Print
+{
+public:
+  TFT_eSPI(int16_t w = 240, int16_t h = 320) : width_(w), height_(h), rotation_(0), dma_busy_(false) {}
+
+  void    init() {}
+  void    begin() {}
+  int16_t width() const { return rotation_ & 1 ? height_ : width_; }
+  int16_t height() const { return rotation_ & 1 ? width_ : height_; }
+  uint8_t getRotation() const { return rotation_; }
+  void    setRotation(uint8_t r) { rotation_ = r & 3; }
+
+  void    fillScreen(uint32_t) {}
+  void    drawPixel(int32_t, int32_t, uint32_t) {}
+  void    drawCircle(int32_t, int32_t, int32_t, uint32_t) {}
+  void    fillCircle(int32_t, int32_t, int32_t, uint32_t) {}
+  void    fillRect(int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+  void    drawFastVLine(int32_t, int32_t, int32_t, uint32_t) {}
+  void    drawFastHLine(int32_t, int32_t, int32_t, uint32_t) {}
+  void    setCursor(int16_t, int16_t) {}
+  void    setTextSize(uint8_t) {}
+  void    setTextFont(uint8_t) {}
+  void    setTextColor(uint16_t, uint16_t) {}
+  int16_t drawString(const char*, int32_t, int32_t) { return 0; }
+
+  bool    dmaBusy() const { return dma_busy_; }
+  void    setDmaBusy(bool busy) { dma_busy_ = busy; } ///< host only, simulate a running DMA push
+
+private:
+  int16_t width_;
+  int16_t height_;
+  uint8_t rotation_;
+  bool    dma_busy_;
+};
+
+#endif // TFT_E_TOUCH_HOST_TFT_ESPI_H